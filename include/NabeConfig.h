@@ -0,0 +1,3 @@
+#define nabe_VERSION 1.0.0
+
+/* #undef NABE_COMMIT */
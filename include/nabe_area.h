@@ -4,6 +4,7 @@
 #include "thirdparty/source-sdk-stubs/nav_area.h"
 
 #include <algorithm>
+#include <cstdint>
 
 // The code in this file is based on the Source 1 SDK, and is used under the SOURCE 1 SDK LICENSE.
 // https://github.com/ValveSoftware/source-sdk-2013
@@ -92,6 +93,14 @@ public:
 		m_center.z = (m_extent.lo.z + m_extent.hi.z) / 2.0f;
 	}
 
+	// Blocked areas are avoided by all searches. See NABE_PathFinder::SetAreasBlocked.
+	void SetBlocked(bool blocked) { m_isBlocked = blocked; }
+
+	// Index of the area in its map's NABE_NavGraph, set as the graph is built, so that the cost policies of
+	// NavAreaBuildPath reach the graph's data without looking the area up by id.
+	uint32_t GetGraphIndex() const { return m_graph_index; }
+	void SetGraphIndex(uint32_t index) { m_graph_index = index; }
+
 	virtual ~NABE_Area() { }
 
 private:
@@ -126,6 +135,8 @@ private:
 	int m_pending_approaches_this_area_id[MAX_APPROACH_AREAS];
 	int m_pending_approaches_prev_area_id[MAX_APPROACH_AREAS];
 	int m_pending_approaches_next_area_id[MAX_APPROACH_AREAS];
+
+	uint32_t m_graph_index = UINT32_MAX;
 };
 
 #endif // _NABENABE_NABE_AREA_H
@@ -0,0 +1,33 @@
+#include "nabe_batch_controller.h"
+
+#include <algorithm>
+
+NABE_BatchController::NABE_BatchController(size_t min_batch_size, size_t max_batch_size,
+	double target_commit_ms, bool enabled)
+	: m_min_batch_size(std::max<size_t>(1, std::min(min_batch_size, max_batch_size))),
+	m_max_batch_size(std::max<size_t>(1, max_batch_size)),
+	m_target_commit_ms(target_commit_ms),
+	m_enabled(enabled)
+{
+	// Start small, and let the backlog grow us.
+	m_batch_size = m_enabled ? m_min_batch_size : m_max_batch_size;
+}
+
+bool NABE_BatchController::Update(size_t num_busy_waits, double commit_ms, size_t backlog)
+{
+	if (!m_enabled) {
+		return false;
+	}
+
+	const auto previous_batch_size = m_batch_size;
+
+	if (num_busy_waits != 0 || commit_ms > m_target_commit_ms) {
+		// Back off quickly, the game server may be waiting on us.
+		m_batch_size = std::max(m_min_batch_size, m_batch_size / 2);
+	}
+	else if (backlog != 0) {
+		m_batch_size = std::min(m_max_batch_size, m_batch_size + std::max<size_t>(1, m_batch_size / 4));
+	}
+
+	return m_batch_size != previous_batch_size;
+}
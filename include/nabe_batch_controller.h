@@ -0,0 +1,29 @@
+#ifndef NABENABE_BATCH_CONTROLLER_H
+#define NABENABE_BATCH_CONTROLLER_H
+
+#include <cstddef>
+
+// Purpose: Decides how many jobs to take on per loop, from the lock contention observed on the previous loop.
+// The batch grows while there's a backlog and the database stays uncontended, and is halved as soon as
+// anyone had to wait for the lock, or committing our writes took longer than the target.
+// When disabled, the batch size is always the max.
+class NABE_BatchController
+{
+public:
+	NABE_BatchController(size_t min_batch_size = 1, size_t max_batch_size = 1,
+		double target_commit_ms = 20, bool enabled = false);
+
+	size_t GetBatchSize() const { return m_batch_size; }
+
+	// Returns true if the batch size changed.
+	bool Update(size_t num_busy_waits, double commit_ms, size_t backlog);
+
+private:
+	size_t m_min_batch_size;
+	size_t m_max_batch_size;
+	size_t m_batch_size;
+	double m_target_commit_ms;
+	bool m_enabled;
+};
+
+#endif // NABENABE_BATCH_CONTROLLER_H
@@ -0,0 +1,77 @@
+#include "nabe_danger_field.h"
+
+#include "thirdparty/source-sdk-stubs/nav.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define NABE_DANGER_SSE
+#endif
+
+void NABE_DangerField::Init(const NABE_NavGraph* graph, float half_life_seconds, size_t decay_interval_ms)
+{
+	m_graph = graph;
+	m_half_life_seconds = half_life_seconds;
+	m_decay_interval = std::chrono::milliseconds(decay_interval_ms);
+	m_last_decay = std::chrono::steady_clock::now();
+
+	const auto padded_size = (graph->GetNumAreas() + 3) & ~size_t(3);
+	for (auto& danger : m_danger) {
+		danger.assign(padded_size, 0.0f);
+	}
+}
+
+bool NABE_DangerField::IncreaseDanger(uint32_t area, int team, float amount)
+{
+	const auto team_index = GetTeamIndex(team);
+	if (team_index < 0 || area >= m_graph->GetNumAreas()) {
+		return false;
+	}
+	auto& danger = m_danger[team_index][area];
+	danger = std::min(danger + amount, MAX_DANGER);
+	return true;
+}
+
+void NABE_DangerField::Update(std::chrono::steady_clock::time_point now)
+{
+	const auto elapsed = now - m_last_decay;
+	if (elapsed < m_decay_interval || m_half_life_seconds <= 0) {
+		return;
+	}
+	m_last_decay = now;
+
+	const float factor = GetDecayFactor(std::chrono::duration<float>(elapsed).count(), m_half_life_seconds);
+	for (auto& danger : m_danger) {
+		float* values = danger.data();
+		const size_t size = danger.size();
+#ifdef NABE_DANGER_SSE
+		const __m128 factors = _mm_set1_ps(factor);
+		const __m128 min_danger = _mm_set1_ps(MIN_DANGER);
+		for (size_t i = 0; i < size; i += 4) {
+			const __m128 decayed = _mm_mul_ps(_mm_loadu_ps(values + i), factors);
+			_mm_storeu_ps(values + i, _mm_and_ps(decayed, _mm_cmpge_ps(decayed, min_danger)));
+		}
+#else
+		for (size_t i = 0; i < size; ++i) {
+			const float decayed = values[i] * factor;
+			values[i] = (decayed >= MIN_DANGER) ? decayed : 0.0f;
+		}
+#endif
+	}
+}
+
+float NABE_DangerField::GetDecayFactor(float seconds, float half_life_seconds)
+{
+	if (half_life_seconds <= 0) {
+		return 1.0f;
+	}
+	return std::exp2(-seconds / half_life_seconds);
+}
+
+int NABE_DangerField::GetTeamIndex(int team)
+{
+	const int team_index = team - static_cast<int>(TEAM_JINRAI);
+	return (team_index >= 0 && team_index < NUM_TEAMS) ? team_index : -1;
+}
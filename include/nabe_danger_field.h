@@ -0,0 +1,71 @@
+#ifndef NABENABE_DANGER_FIELD_H
+#define NABENABE_DANGER_FIELD_H
+
+#include "nabe_nav_graph.h"
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// Purpose: One reported danger event, eg. a player of the team killed or damaged in the area.
+struct NABE_DangerEvent {
+	int area_id;
+	int team;
+	float amount;
+};
+
+// Purpose: How dangerous each nav area of a map has recently been for each team, for the safest route searches.
+// Danger decays exponentially over time, like the danger of CNavArea in the SDK.
+//
+// Stored apart from the areas, as an array per team indexed like the graph's areas (struct of arrays),
+// so that decaying every area at once is a single vectorized pass over contiguous memory.
+class NABE_DangerField
+{
+public:
+	// Playable teams of nav.h: TEAM_JINRAI and TEAM_NSF.
+	static constexpr int NUM_TEAMS = 2;
+	static constexpr float MAX_DANGER = 1.0f;
+	// Danger below this is dropped to zero, so that old danger doesn't linger forever.
+	static constexpr float MIN_DANGER = 1.0f / 1024;
+
+	// The danger halves every half_life_seconds (0 to never decay), applied every decay_interval_ms at most.
+	void Init(const NABE_NavGraph* graph, float half_life_seconds, size_t decay_interval_ms);
+
+	bool IsBuilt() const { return m_graph != nullptr; }
+
+	// Add danger to an area for a team, up to MAX_DANGER. Returns false for unknown teams.
+	bool IncreaseDanger(uint32_t area, int team, float amount);
+
+	// Decay the danger of every area, if decay_interval_ms has passed since the previous decay.
+	void Update(std::chrono::steady_clock::time_point now);
+
+	float GetDanger(uint32_t area, int team) const
+	{
+		const auto team_index = GetTeamIndex(team);
+		return (team_index < 0) ? 0.0f : m_danger[team_index][area];
+	}
+
+	// For SafestRouteCost of nav_pathfind.h.
+	float GetDanger(const CNavArea* area, int team) const
+	{
+		const auto index = NABE_NavGraph::GetIndex(area);
+		return (index == NABE_NavGraph::INVALID_INDEX) ? 0.0f : GetDanger(index, team);
+	}
+
+	// How much of a danger remains after the given time.
+	static float GetDecayFactor(float seconds, float half_life_seconds);
+
+private:
+	static int GetTeamIndex(int team);
+
+private:
+	const NABE_NavGraph* m_graph = nullptr;
+	float m_half_life_seconds = 0;
+	std::chrono::steady_clock::duration m_decay_interval{};
+	std::chrono::steady_clock::time_point m_last_decay;
+
+	// Padded to a multiple of 4 areas, so that the decay needs no scalar remainder loop.
+	std::vector<float> m_danger[NUM_TEAMS];
+};
+
+#endif // NABENABE_DANGER_FIELD_H
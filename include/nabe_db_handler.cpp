@@ -0,0 +1,1283 @@
+#include "nabe_db_handler.h"
+
+#include "nabe_pathfinder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+static constexpr auto jobs_table_identifier = "nabejobs";
+static constexpr auto solutions_table_identifier = "nabesols";
+static constexpr auto area_solutions_table_identifier = "nabeareasols";
+static constexpr auto blocked_areas_table_identifier = "nabeblocked";
+static constexpr auto danger_table_identifier = "nabedanger";
+
+static constexpr size_t query_max_size = 100 * 1024;
+
+// Return Unix epoch
+static size_t GetEpoch()
+{
+	return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock().now().time_since_epoch()).count();
+}
+
+// Callbacks receive the object to write their results to as the user data.
+
+static int callback_bool(void* data, int argc, char** argv, char** az_col_name)
+{
+	const bool sql_success = (argc == 1 && argv[0]);
+	*static_cast<bool*>(data) = (sql_success && (atoi(argv[0]) == 1));
+	return sql_success ? SQLITE_OK : SQLITE_ERROR;
+}
+
+static int callback_string(void* data, int argc, char** argv, char** az_col_name)
+{
+	*static_cast<std::string*>(data) = (argc >= 1 && argv[0]) ? argv[0] : "";
+	return SQLITE_OK;
+}
+
+static int callback_area_solution_steps(void* data, int argc, char** argv, char** az_col_name)
+{
+	if (argc != 1 || !argv[0]) {
+		return SQLITE_ERROR;
+	}
+	static_cast<std::vector<int>*>(data)->push_back(atoi(argv[0]));
+	return SQLITE_OK;
+}
+
+static int callback_tables_with_jobs(void* data, int argc, char** argv, char** az_col_name)
+{
+	auto tables_have_jobs = static_cast<std::vector<bool>*>(data);
+	if (argc != static_cast<int>(tables_have_jobs->size())) {
+		return SQLITE_ERROR;
+	}
+	for (int i = 0; i < argc; ++i) {
+		(*tables_have_jobs)[i] = (argv[i] && atoi(argv[i]) == 1);
+	}
+	return SQLITE_OK;
+}
+
+static int callback_claimed_jobs(void* data, int argc, char** argv, char** az_col_name)
+{
+	if (argc != 1 || !argv[0]) {
+		return SQLITE_ERROR;
+	}
+	static_cast<std::set<long long>*>(data)->insert(strtoll(argv[0], nullptr, 10));
+	return SQLITE_OK;
+}
+
+static int callback_blocked_areas(void* data, int argc, char** argv, char** az_col_name)
+{
+	if (argc != 4 || !argv[0] || !argv[1] || !argv[2] || !argv[3]) {
+		return SQLITE_ERROR;
+	}
+	static_cast<std::vector<std::pair<Vector, bool>>*>(data)->emplace_back(
+		Vector(
+			static_cast<float>(atof(argv[0])),
+			static_cast<float>(atof(argv[1])),
+			static_cast<float>(atof(argv[2]))),
+		atoi(argv[3]) != 0);
+	return SQLITE_OK;
+}
+
+// A single row of the danger tables.
+struct DangerRow {
+	long long id;
+	size_t epoch;
+	Vector pos;
+	int team;
+	float amount;
+};
+
+static int callback_danger(void* data, int argc, char** argv, char** az_col_name)
+{
+	if (argc != 7 || !argv[0] || !argv[1] || !argv[2] || !argv[3] || !argv[4] || !argv[5] || !argv[6]) {
+		return SQLITE_ERROR;
+	}
+	DangerRow row;
+	row.id = strtoll(argv[0], nullptr, 10);
+	row.epoch = static_cast<size_t>(strtoull(argv[1], nullptr, 10));
+	row.pos = Vector(
+		static_cast<float>(atof(argv[2])),
+		static_cast<float>(atof(argv[3])),
+		static_cast<float>(atof(argv[4])));
+	row.team = atoi(argv[5]);
+	row.amount = static_cast<float>(atof(argv[6]));
+	static_cast<std::vector<DangerRow>*>(data)->push_back(row);
+	return SQLITE_OK;
+}
+
+static int callback_positions(void* data, int argc, char** argv, char** az_col_name)
+{
+	if (argc != 6) {
+		return SQLITE_ERROR;
+	}
+	auto positions = static_cast<std::vector<Vector>*>(data);
+	for (int i = 0; i < argc; i += 3) {
+		if (!argv[i] || !argv[i + 1] || !argv[i + 2]) {
+			return SQLITE_ERROR;
+		}
+		positions->emplace_back(
+			static_cast<float>(atof(argv[i])),
+			static_cast<float>(atof(argv[i + 1])),
+			static_cast<float>(atof(argv[i + 2])));
+	}
+	return SQLITE_OK;
+}
+
+// Back off exponentially from 1 ms, with jitter so that competing connections don't retry in lockstep.
+// A short SourceMod write lock then only costs us a few milliseconds, instead of whole seconds.
+static int sqlite_busy_handler(void* data, int num)
+{
+	auto state = static_cast<NABE_BusyHandlerState*>(data);
+
+	// SQLite counts the invocations for the same lock, starting from zero.
+	if (num == 0) {
+		state->waited_ms = 0;
+	}
+
+	const int time_left_ms = state->timeout_ms - state->waited_ms;
+	if (time_left_ms <= 0 || static_cast<size_t>(num) >= state->max_retries) {
+		++state->num_timeouts;
+		print(Warning, "DB was busy. Gave up after %d retries (%d ms).", num, state->waited_ms);
+		return 0;
+	}
+
+	constexpr int max_backoff_exponent = 7; // Don't back off further than 128 ms per retry.
+	const int backoff_ms = 1 << std::min(num, max_backoff_exponent);
+	const int sleep_ms = std::min(time_left_ms,
+		std::uniform_int_distribution<int>(backoff_ms / 2 + 1, backoff_ms)(state->rng));
+
+	sqlite3_sleep(sleep_ms);
+	state->waited_ms += sleep_ms;
+	state->total_waited_ms += sleep_ms;
+	++state->num_waits;
+
+	return 1;
+}
+
+NABE_DatabaseHandler::NABE_DatabaseHandler(NABE_PathFinder* pathfinder, const NABE_DatabaseSettings& settings, bool verbosity)
+	: m_pathfinder(pathfinder),
+	m_settings(settings),
+	m_query(query_max_size),
+	m_verbosity(verbosity)
+{
+	if (m_settings.adaptive_batch_size) {
+		m_batch_controller = NABE_BatchController(m_settings.min_solves_at_once, m_settings.max_solves_at_once,
+			m_settings.target_commit_ms, true);
+	}
+	else {
+		m_batch_controller = NABE_BatchController(m_settings.max_solves_at_once, m_settings.max_solves_at_once);
+	}
+
+	auto worker_id_literal = sqlite3_mprintf("%Q", m_settings.worker_id.c_str());
+	m_worker_id_sql_literal = worker_id_literal;
+	sqlite3_free(worker_id_literal);
+
+	m_busy_state.max_retries = m_settings.max_retries;
+	m_busy_state.timeout_ms = m_settings.tuning.busy_timeout_ms;
+
+	if (m_settings.danger_poll_interval_ms != 0) {
+		m_danger_layer = m_pathfinder->AddDangerLayer();
+	}
+}
+
+NABE_DatabaseHandler::~NABE_DatabaseHandler()
+{
+	if (!m_db) {
+		return;
+	}
+
+	if (m_settings.tuning.incremental_vacuum) {
+		print(Info, "Cleaning up any dirty navigation data from database...");
+		IncrementalVacuum();
+	}
+
+	print(Info, "Closing database connection...");
+	sqlite3_close(m_db);
+}
+
+bool NABE_DatabaseHandler::Open()
+{
+	const auto db_path = m_settings.location.c_str();
+
+	if (!fs::exists(fs::path(db_path)) && !m_settings.create_db_if_not_exists) {
+		print(Error, "%s:  Database path doesn't exist: \"%s\"", __FUNCTION__, db_path);
+		return false;
+	}
+
+	// Jobs are claimed with UPDATE ... RETURNING.
+	if (sqlite3_libversion_number() < 3035000) {
+		print(Error, "%s: SQLite %s is too old, claiming jobs needs UPDATE ... RETURNING from SQLite 3.35.0 or newer.",
+			__FUNCTION__, sqlite3_libversion());
+		return false;
+	}
+
+	print(Info, "Opening SQLite database location: \"%s\"", db_path);
+	if (sqlite3_open(db_path, &m_db) != SQLITE_OK) {
+		print(Error, "%s: Can't open database: %s", __FUNCTION__, sqlite3_errmsg(m_db));
+		sqlite3_close(m_db);
+		m_db = nullptr;
+		return false;
+	}
+
+	sqlite3_busy_handler(m_db, &sqlite_busy_handler, &m_busy_state);
+
+	if (!ApplyTuning()) {
+		print(Error, "%s: Failed to apply database settings.", __FUNCTION__);
+		return false;
+	}
+	return true;
+}
+
+bool NABE_DatabaseHandler::SqlQuery(const char* sql_query, const sql_callback sqlite_cb, void* data)
+{
+	char* error_msg = nullptr;
+	if (sqlite3_exec(m_db, sql_query, sqlite_cb, data, &error_msg) != SQLITE_OK) {
+		print(Error, "SQL error:\t%s", error_msg);
+		sqlite3_free(error_msg);
+		return false;
+	}
+	return true;
+}
+
+void NABE_DatabaseHandler::ReportBusyStats()
+{
+	if (m_verbosity && m_busy_state.num_waits != 0) {
+		print(Info, "%s: DB was busy: %zd waits totaling %d ms, %zd queries gave up.", __FUNCTION__,
+			m_busy_state.num_waits, m_busy_state.total_waited_ms, m_busy_state.num_timeouts);
+	}
+	m_busy_state.num_waits = 0;
+	m_busy_state.num_timeouts = 0;
+	m_busy_state.total_waited_ms = 0;
+}
+
+bool NABE_DatabaseHandler::ApplyTuning()
+{
+	const auto& tuning = m_settings.tuning;
+	std::string pragma_value;
+
+	if (tuning.journal_mode_wal) {
+		if (!SqlQuery("PRAGMA journal_mode=WAL;", &callback_string, &pragma_value)) {
+			return false;
+		}
+		if (pragma_value.compare("wal") != 0) {
+			print(Warning, "%s: Could not enable WAL mode; journal mode is \"%s\"", __FUNCTION__, pragma_value.c_str());
+		}
+	}
+
+	if (tuning.synchronous_normal) {
+		if (!SqlQuery("PRAGMA synchronous=NORMAL;", NULL)) {
+			return false;
+		}
+	}
+
+	if (tuning.mmap_size > 0) {
+		snprintf(m_query.data(), m_query.size(), "PRAGMA mmap_size=%lld;", tuning.mmap_size);
+		if (!SqlQuery(m_query.data(), NULL)) {
+			return false;
+		}
+	}
+
+	if (tuning.cache_size_kb > 0) {
+		// Negative values are interpreted by SQLite as KiB, rather than number of pages.
+		snprintf(m_query.data(), m_query.size(), "PRAGMA cache_size=-%lld;", tuning.cache_size_kb);
+		if (!SqlQuery(m_query.data(), NULL)) {
+			return false;
+		}
+	}
+
+	if (tuning.incremental_vacuum) {
+		if (!SqlQuery("PRAGMA auto_vacuum;", &callback_string, &pragma_value)) {
+			return false;
+		}
+		constexpr auto auto_vacuum_incremental = "2";
+		if (pragma_value.compare(auto_vacuum_incremental) != 0) {
+			// Changing the auto_vacuum mode of an existing database only takes effect after a full VACUUM.
+			// This only has to happen once, after which the idle loop keeps the file compact.
+			print(Info, "Converting database to incremental auto vacuum. This may take a few moments...");
+			if (!SqlQuery("PRAGMA auto_vacuum=INCREMENTAL;", NULL) || !SqlQuery("VACUUM;", NULL)) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+void NABE_DatabaseHandler::OnIdle()
+{
+	if (m_settings.tuning.incremental_vacuum) {
+		IncrementalVacuum();
+	}
+}
+
+bool NABE_DatabaseHandler::AddMap(const NABE_GameMap* map)
+{
+	if (!m_db) {
+		print(Error, "%s: Database is not open.", __FUNCTION__);
+		return false;
+	}
+
+	// Jobs table
+	{
+		constexpr auto schema =
+			"CREATE TABLE IF NOT EXISTS %s_%zd_%s(\n"
+			"\tepoch INTEGER NOT NULL,\n"
+			"\tfrom_area_x REAL NOT NULL,\n"
+			"\tfrom_area_y REAL NOT NULL,\n"
+			"\tfrom_area_z REAL NOT NULL,\n"
+			"\tto_area_x REAL NOT NULL,\n"
+			"\tto_area_y REAL NOT NULL,\n"
+			"\tto_area_z REAL NOT NULL,\n"
+			"\tpriority INTEGER NOT NULL DEFAULT 0,\n"
+			"\tclaimed_by TEXT DEFAULT NULL,\n"
+			"\tclaimed_at INTEGER NOT NULL DEFAULT 0,\n"
+			"\tavoid_attributes INTEGER NOT NULL DEFAULT 0,\n"
+			"\tallow_attributes INTEGER NOT NULL DEFAULT 0,\n"
+			"\tsafest INTEGER NOT NULL DEFAULT 0,\n"
+			"\tteam INTEGER NOT NULL DEFAULT 0,\n"
+			"\tround_time INTEGER NOT NULL DEFAULT -1,\n"
+			"\tseek_enemy INTEGER NOT NULL DEFAULT 0,\n"
+			"\tUNIQUE (from_area_x, from_area_y, from_area_z, "
+			"to_area_x, to_area_y, to_area_z)\n);";
+
+		constexpr size_t query_max_size = 1024;
+		char query[query_max_size]{ 0 };
+		snprintf(query, query_max_size, schema,
+			jobs_table_identifier,
+			map->map_size,
+			map->map_name.c_str());
+
+		SqlQuery(query, NULL);
+
+		if (!TableExists(jobs_table_identifier, map)) {
+			print(Error, "%s: Failed to create job table", __FUNCTION__);
+			return false;
+		}
+		else {
+			if (m_verbosity) {
+				print(Info, "%s: Job table exists for: %s", __FUNCTION__, map->map_name.c_str());
+			}
+		}
+
+		char table[query_max_size]{ 0 };
+		snprintf(table, query_max_size, "%s_%zd_%s",
+			jobs_table_identifier,
+			map->map_size,
+			map->map_name.c_str());
+
+		// Tables created by older versions don't have these columns yet.
+		if (!AddColumnIfNotExists(table, "priority", "INTEGER NOT NULL DEFAULT 0") ||
+			!AddColumnIfNotExists(table, "claimed_by", "TEXT DEFAULT NULL") ||
+			!AddColumnIfNotExists(table, "claimed_at", "INTEGER NOT NULL DEFAULT 0") ||
+			!AddColumnIfNotExists(table, "avoid_attributes", "INTEGER NOT NULL DEFAULT 0") ||
+			!AddColumnIfNotExists(table, "allow_attributes", "INTEGER NOT NULL DEFAULT 0") ||
+			!AddColumnIfNotExists(table, "safest", "INTEGER NOT NULL DEFAULT 0") ||
+			!AddColumnIfNotExists(table, "team", "INTEGER NOT NULL DEFAULT 0") ||
+			!AddColumnIfNotExists(table, "round_time", "INTEGER NOT NULL DEFAULT -1") ||
+			!AddColumnIfNotExists(table, "seek_enemy", "INTEGER NOT NULL DEFAULT 0"))
+		{
+			print(Error, "%s: Failed to add missing columns to job table", __FUNCTION__);
+			return false;
+		}
+
+		m_jobs_tables.push_back(table);
+		m_jobs_tables_by_map[map->map_name] = table;
+	}
+
+	// Solution tables
+	{
+		constexpr auto schema =
+			"CREATE TABLE IF NOT EXISTS %s_%zd_%s(\n"
+			"\tepoch INTEGER NOT NULL,\n"
+			"\tfrom_area_x REAL NOT NULL,\n"
+			"\tfrom_area_y REAL NOT NULL,\n"
+			"\tfrom_area_z REAL NOT NULL,\n"
+			"\tto_area_x REAL NOT NULL,\n"
+			"\tto_area_y REAL NOT NULL,\n"
+			"\tto_area_z REAL NOT NULL,\n"
+			"\tstep_num INTEGER NOT NULL,\n"
+			"\tpass_area_x REAL NOT NULL,\n"
+			"\tpass_area_y REAL NOT NULL,\n"
+			"\tpass_area_z REAL NOT NULL,\n"
+			"\tis_partial INTEGER NOT NULL DEFAULT 0,\n"
+			"\tavoid_attributes INTEGER NOT NULL DEFAULT 0,\n"
+			"\tallow_attributes INTEGER NOT NULL DEFAULT 0,\n"
+			"\tsafest INTEGER NOT NULL DEFAULT 0,\n"
+			"\tteam INTEGER NOT NULL DEFAULT 0,\n"
+			"\tround_time INTEGER NOT NULL DEFAULT -1,\n"
+			"\tseek_enemy INTEGER NOT NULL DEFAULT 0,\n"
+			"\twaypoint_deltas TEXT DEFAULT NULL,\n"
+			"\tUNIQUE(from_area_x, from_area_y, from_area_z, "
+			"to_area_x, to_area_y, to_area_z, step_num)\n);";
+
+		constexpr size_t query_max_size = 1024;
+		char query[query_max_size]{ 0 };
+		snprintf(query, query_max_size, schema,
+			solutions_table_identifier,
+			map->map_size,
+			map->map_name.c_str());
+
+		SqlQuery(query, NULL);
+
+		if (!TableExists(solutions_table_identifier, map)) {
+			print(Error, "%s: Failed to create solution table", __FUNCTION__);
+			return false;
+		}
+		else {
+			if (m_verbosity) {
+				print(Info, "%s: Solutions table exists for: %s", __FUNCTION__, map->map_name.c_str());
+			}
+		}
+
+		char table[query_max_size]{ 0 };
+		snprintf(table, query_max_size, "%s_%zd_%s",
+			solutions_table_identifier,
+			map->map_size,
+			map->map_name.c_str());
+
+		if (!AddColumnIfNotExists(table, "is_partial", "INTEGER NOT NULL DEFAULT 0") ||
+			!AddColumnIfNotExists(table, "avoid_attributes", "INTEGER NOT NULL DEFAULT 0") ||
+			!AddColumnIfNotExists(table, "allow_attributes", "INTEGER NOT NULL DEFAULT 0") ||
+			!AddColumnIfNotExists(table, "safest", "INTEGER NOT NULL DEFAULT 0") ||
+			!AddColumnIfNotExists(table, "team", "INTEGER NOT NULL DEFAULT 0") ||
+			!AddColumnIfNotExists(table, "round_time", "INTEGER NOT NULL DEFAULT -1") ||
+			!AddColumnIfNotExists(table, "seek_enemy", "INTEGER NOT NULL DEFAULT 0") ||
+			!AddColumnIfNotExists(table, "waypoint_deltas", "TEXT DEFAULT NULL"))
+		{
+			print(Error, "%s: Failed to add missing columns to solution table", __FUNCTION__);
+			return false;
+		}
+	}
+
+	// Area-keyed solution tables
+	if (m_settings.persist_area_solutions) {
+		constexpr auto schema =
+			"CREATE TABLE IF NOT EXISTS %s_%zd_%s(\n"
+			"\tepoch INTEGER NOT NULL,\n"
+			"\tfrom_area_id INTEGER NOT NULL,\n"
+			"\tto_area_id INTEGER NOT NULL,\n"
+			"\tstep_num INTEGER NOT NULL,\n"
+			"\tpass_area_id INTEGER NOT NULL,\n"
+			"\tUNIQUE(from_area_id, to_area_id, step_num)\n);";
+
+		constexpr size_t query_max_size = 1024;
+		char query[query_max_size]{ 0 };
+		snprintf(query, query_max_size, schema,
+			area_solutions_table_identifier,
+			map->map_size,
+			map->map_name.c_str());
+
+		SqlQuery(query, NULL);
+
+		if (!TableExists(area_solutions_table_identifier, map)) {
+			print(Error, "%s: Failed to create area solution table", __FUNCTION__);
+			return false;
+		}
+		else {
+			if (m_verbosity) {
+				print(Info, "%s: Area solutions table exists for: %s", __FUNCTION__, map->map_name.c_str());
+			}
+		}
+	}
+
+	// Blocked areas tables
+	if (m_settings.blocked_poll_interval_ms != 0) {
+		constexpr auto schema =
+			"CREATE TABLE IF NOT EXISTS %s_%zd_%s(\n"
+			"\tepoch INTEGER NOT NULL,\n"
+			"\tarea_x REAL NOT NULL,\n"
+			"\tarea_y REAL NOT NULL,\n"
+			"\tarea_z REAL NOT NULL,\n"
+			"\tblocked INTEGER NOT NULL,\n"
+			"\tUNIQUE(area_x, area_y, area_z)\n);";
+
+		constexpr size_t query_max_size = 1024;
+		char query[query_max_size]{ 0 };
+		snprintf(query, query_max_size, schema,
+			blocked_areas_table_identifier,
+			map->map_size,
+			map->map_name.c_str());
+
+		SqlQuery(query, NULL);
+
+		if (!TableExists(blocked_areas_table_identifier, map)) {
+			print(Error, "%s: Failed to create blocked areas table", __FUNCTION__);
+			return false;
+		}
+		else {
+			if (m_verbosity) {
+				print(Info, "%s: Blocked areas table exists for: %s", __FUNCTION__, map->map_name.c_str());
+			}
+		}
+	}
+
+	// Danger tables
+	if (m_settings.danger_poll_interval_ms != 0) {
+		// Events are read in the order of their id, which must never be reused, even after the table has emptied.
+		constexpr auto schema =
+			"CREATE TABLE IF NOT EXISTS %s_%zd_%s(\n"
+			"\tid INTEGER PRIMARY KEY AUTOINCREMENT,\n"
+			"\tepoch INTEGER NOT NULL,\n"
+			"\tarea_x REAL NOT NULL,\n"
+			"\tarea_y REAL NOT NULL,\n"
+			"\tarea_z REAL NOT NULL,\n"
+			"\tteam INTEGER NOT NULL,\n"
+			"\tamount REAL NOT NULL\n);";
+
+		constexpr size_t query_max_size = 1024;
+		char query[query_max_size]{ 0 };
+
+		// Tables created by older versions have no id, and reuse rowids. Their events fade out within minutes,
+		// so they're just dropped rather than migrated.
+		char table[query_max_size]{ 0 };
+		snprintf(table, query_max_size, "%s_%zd_%s",
+			danger_table_identifier,
+			map->map_size,
+			map->map_name.c_str());
+		bool has_id = true;
+		if (TableExists(danger_table_identifier, map) && ColumnExists(table, "id", has_id) && !has_id) {
+			print(Warning, "%s: Recreating danger table %s without ids", __FUNCTION__, table);
+			snprintf(query, query_max_size, "DROP TABLE %s;", table);
+			SqlQuery(query, NULL);
+		}
+
+		snprintf(query, query_max_size, schema,
+			danger_table_identifier,
+			map->map_size,
+			map->map_name.c_str());
+
+		SqlQuery(query, NULL);
+
+		if (!TableExists(danger_table_identifier, map)) {
+			print(Error, "%s: Failed to create danger table", __FUNCTION__);
+			return false;
+		}
+		else {
+			if (m_verbosity) {
+				print(Info, "%s: Danger table exists for: %s", __FUNCTION__, map->map_name.c_str());
+			}
+		}
+	}
+
+	return true;
+}
+
+// Empty tables are skipped with a single cheap existence check, and the remaining tables are read
+// with one compound query, each contributing at most a batch worth of its best jobs.
+// These are merged into one priority queue, and the best jobs overall are claimed for dispatch.
+void NABE_DatabaseHandler::FetchJobs(std::vector<NABE_Job>& out_jobs)
+{
+	if (m_batch_controller.Update(m_busy_state.num_waits, m_last_commit_ms, m_last_backlog) && m_verbosity) {
+		print(Info, "%s: Batch size is now %zd (busy waits: %zd, commit: %.1f ms, backlog: %zd)", __FUNCTION__,
+			m_batch_controller.GetBatchSize(), m_busy_state.num_waits, m_last_commit_ms, m_last_backlog);
+	}
+	m_last_commit_ms = 0;
+	m_last_backlog = 0;
+
+	ReportBusyStats();
+
+	if (!m_db || m_jobs_tables.empty()) {
+		return;
+	}
+
+	// Between batches, so that the jobs of a batch are all solved against the same state.
+	if (m_settings.blocked_poll_interval_ms != 0) {
+		PollBlockedAreas();
+	}
+	if (m_settings.danger_poll_interval_ms != 0) {
+		PollDanger();
+	}
+
+	// Jobs that nobody else is working on.
+	constexpr size_t claimable_max_size = 512;
+	char claimable[claimable_max_size]{ 0 };
+	snprintf(claimable, claimable_max_size, "(claimed_by IS NULL OR claimed_by = %s OR claimed_at < %zd)",
+		m_worker_id_sql_literal.c_str(), GetEpoch() - m_settings.claim_lease_seconds);
+
+	std::string query{ "SELECT " };
+	for (size_t i = 0; i < m_jobs_tables.size(); ++i) {
+		if (i != 0) {
+			query += ", ";
+		}
+		query += "EXISTS(SELECT 1 FROM " + m_jobs_tables[i] + " WHERE " + claimable + ")";
+	}
+	query += ';';
+
+	std::vector<bool> tables_have_jobs(m_jobs_tables.size(), false);
+	if (!SqlQuery(query.c_str(), &callback_tables_with_jobs, &tables_have_jobs)) {
+		return;
+	}
+
+	const auto batch_size = m_batch_controller.GetBatchSize();
+
+	constexpr size_t append_max_size = 1024;
+	char append[append_max_size]{ 0 };
+	query.clear();
+	for (size_t i = 0; i < m_jobs_tables.size(); ++i) {
+		if (!tables_have_jobs[i]) {
+			continue;
+		}
+		snprintf(append, append_max_size, "%sSELECT * FROM (SELECT '%s', rowid, priority, epoch, "
+			"from_area_x, from_area_y, from_area_z, "
+			"to_area_x, to_area_y, to_area_z, avoid_attributes, allow_attributes, safest, team, "
+			"round_time, seek_enemy "
+			"FROM %s "
+			"WHERE %s "
+			"ORDER BY priority DESC, epoch DESC "
+			"LIMIT %zd)", // see comment about reasoning for the max batch size in NABE_DatabaseSettings
+			(query.empty() ? "" : " UNION ALL "),
+			m_jobs_tables[i].c_str(), m_jobs_tables[i].c_str(), claimable, batch_size + 1);
+		query += append;
+	}
+
+	// Every map is idle
+	if (query.empty()) {
+		return;
+	}
+	query += ';';
+
+	struct JobQueue {
+		std::priority_queue<NabeScheduledJob> queue;
+		std::map<std::string, size_t> ranks;
+		// Rows that can't be solved, by table, to be deleted so that they don't come up again every loop.
+		std::map<std::string, std::vector<long long>> invalid_rowids;
+	} job_queue;
+
+	auto callback_get_jobs = [](void* data, int argc, char** argv, char** az_col_name) -> int {
+		if (argc != 16) {
+			return SQLITE_ERROR;
+		}
+
+		auto job_queue = static_cast<JobQueue*>(data);
+
+		NabeScheduledJob scheduled_job;
+		scheduled_job.job.table = argv[0];
+		scheduled_job.job.rowid = strtoll(argv[1], nullptr, 10);
+		scheduled_job.priority = atoi(argv[2]);
+		scheduled_job.epoch = static_cast<size_t>(strtoull(argv[3], nullptr, 10));
+		scheduled_job.rank = job_queue->ranks[scheduled_job.job.table]++;
+
+		scheduled_job.job.pos_from = Vector(
+			static_cast<float>(atof(argv[4])),
+			static_cast<float>(atof(argv[5])),
+			static_cast<float>(atof(argv[6]))
+		);
+
+		scheduled_job.job.pos_to = Vector(
+			static_cast<float>(atof(argv[7])),
+			static_cast<float>(atof(argv[8])),
+			static_cast<float>(atof(argv[9]))
+		);
+
+		scheduled_job.job.route.avoid_attributes = atoi(argv[10]);
+		scheduled_job.job.route.allow_attributes = atoi(argv[11]);
+		scheduled_job.job.route.safest = atoi(argv[12]) != 0;
+		scheduled_job.job.route.team = atoi(argv[13]);
+		scheduled_job.job.route.round_time = atoi(argv[14]);
+		scheduled_job.job.route.seek_enemy = atoi(argv[15]) != 0;
+
+		if (!scheduled_job.job.pos_from.IsValid() || !scheduled_job.job.pos_to.IsValid()) {
+			print(Error, "%s: %s: Invalid position vectors(s) of job %lld, deleting it", __FUNCTION__,
+				scheduled_job.job.table.c_str(), scheduled_job.job.rowid);
+			job_queue->invalid_rowids[scheduled_job.job.table].push_back(scheduled_job.job.rowid);
+			return SQLITE_OK;
+		}
+
+		job_queue->queue.push(scheduled_job);
+
+		return SQLITE_OK;
+	};
+	SqlQuery(query.c_str(), callback_get_jobs, &job_queue);
+
+	for (auto& table_rowids : job_queue.invalid_rowids) {
+		query = "DELETE FROM " + table_rowids.first + " WHERE " + claimable + " AND rowid IN (";
+		for (size_t i = 0; i < table_rowids.second.size(); ++i) {
+			query += (i == 0 ? "" : ", ") + std::to_string(table_rowids.second[i]);
+		}
+		query += ");";
+		SqlQuery(query.c_str(), NULL);
+	}
+
+	std::map<std::string, std::vector<NabeJob>> jobs_to_claim;
+	for (size_t num_jobs = 0; !job_queue.queue.empty() && num_jobs < batch_size; ++num_jobs) {
+		const auto& next = job_queue.queue.top();
+		jobs_to_claim[next.job.table].push_back(next.job);
+		job_queue.queue.pop();
+	}
+	// Jobs we saw but had no room for this loop. Each table contributes one more candidate than fits in a batch,
+	// so that a table with more jobs than that always shows up here; this is still only a lower bound of the backlog.
+	m_last_backlog = job_queue.queue.size();
+
+	// Atomically claim the jobs we picked. Another worker may have claimed some of them
+	// after we read them, and those will be left out of the returned rows.
+	std::set<long long> claimed_rowids;
+	for (auto& table_jobs : jobs_to_claim) {
+		query = "UPDATE " + table_jobs.first + " SET claimed_by = " + m_worker_id_sql_literal +
+			", claimed_at = " + std::to_string(GetEpoch()) + " WHERE " + claimable + " AND rowid IN (";
+		for (size_t i = 0; i < table_jobs.second.size(); ++i) {
+			query += (i == 0 ? "" : ", ") + std::to_string(table_jobs.second[i].rowid);
+		}
+		query += ") RETURNING rowid;";
+
+		claimed_rowids.clear();
+		if (!SqlQuery(query.c_str(), &callback_claimed_jobs, &claimed_rowids)) {
+			continue;
+		}
+
+		const auto map_name = GetMapNameFromTable(table_jobs.first);
+		for (auto& job : table_jobs.second) {
+			if (claimed_rowids.find(job.rowid) == claimed_rowids.end()) {
+				continue;
+			}
+			if (m_verbosity) {
+				print(Info, "%s: %s: Area (%.1f %.1f %.1f) --> (%.1f %.1f %.1f)",
+					__FUNCTION__, job.table.c_str(),
+					job.pos_from.x, job.pos_from.y, job.pos_from.z,
+					job.pos_to.x, job.pos_to.y, job.pos_to.z);
+			}
+
+			NABE_Job claimed_job;
+			claimed_job.map_name = map_name;
+			claimed_job.pos_from = job.pos_from;
+			claimed_job.pos_to = job.pos_to;
+			claimed_job.id = job.rowid;
+			claimed_job.route = job.route;
+			claimed_job.route.danger_layer = m_danger_layer;
+			claimed_job.already_solved = SolutionExists(job);
+			out_jobs.push_back(std::move(claimed_job));
+		}
+	}
+}
+
+bool NABE_DatabaseHandler::LookupPath(const NABE_Job& job, int area_id_from, int area_id_to, std::list<CNavArea*>& out_path)
+{
+	if (!m_settings.persist_area_solutions) {
+		return false;
+	}
+
+	auto table = m_jobs_tables_by_map.find(job.map_name);
+	if (table == m_jobs_tables_by_map.end()) {
+		return false;
+	}
+
+	std::vector<int> area_ids;
+	return GetAreaSolution(GetAreaSolutionsTable(table->second).c_str(), area_id_from, area_id_to, area_ids) &&
+		m_pathfinder->GetPathFromAreaIds(job.map_name, area_ids, out_path);
+}
+
+void NABE_DatabaseHandler::BeginResults()
+{
+	m_persisted_this_batch.clear();
+	m_commit_start = std::chrono::steady_clock::now();
+	SqlQuery("BEGIN;", NULL);
+}
+
+void NABE_DatabaseHandler::WriteResult(const NABE_Job& job, const NABE_JobResult& result)
+{
+	auto table = m_jobs_tables_by_map.find(job.map_name);
+	if (table == m_jobs_tables_by_map.end()) {
+		return;
+	}
+
+	// This job is completed (or failed), so we can delete the row. Deleting it first also tells whether it's still ours:
+	// if our claim expired and another worker took the job over, the answer is left to that worker.
+	if (!DeleteJob(table->second, job.id)) {
+		if (m_verbosity) {
+			print(Warning, "%s: %s: Job %lld is no longer claimed by us, dropping its result.", __FUNCTION__,
+				table->second.c_str(), job.id);
+		}
+		return;
+	}
+
+	if (result.HasPath()) {
+		// Partial paths aren't stored by area, so that later jobs get another chance at the full path.
+		if (result.status == NABE_JobStatus::Solved && result.solved_now && job.route.IsDefault() && m_settings.persist_area_solutions &&
+			m_persisted_this_batch.emplace(job.map_name, result.area_id_from, result.area_id_to).second)
+		{
+			InsertAreaSolution(GetAreaSolutionsTable(table->second).c_str(),
+				result.area_id_from, result.area_id_to, result.path);
+		}
+		InsertSolution(table->second, job, result.waypoints, result.status == NABE_JobStatus::Partial);
+	}
+}
+
+void NABE_DatabaseHandler::EndResults()
+{
+	SqlQuery("COMMIT;", NULL);
+	m_last_commit_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_commit_start).count();
+}
+
+bool NABE_DatabaseHandler::GetRecentPositions(const std::string& map_name, size_t max_num_solutions, std::vector<Vector>& out_positions)
+{
+	out_positions.clear();
+
+	auto table = m_jobs_tables_by_map.find(map_name);
+	if (table == m_jobs_tables_by_map.end()) {
+		return false;
+	}
+
+	// Every solution has exactly one first step.
+	snprintf(m_query.data(), m_query.size(), "SELECT from_area_x, from_area_y, from_area_z, to_area_x, to_area_y, to_area_z "
+		"FROM %s WHERE step_num = 0 ORDER BY epoch DESC LIMIT %zd;",
+		GetSolutionsTable(table->second).c_str(), max_num_solutions);
+
+	std::vector<Vector> positions;
+	if (!SqlQuery(m_query.data(), &callback_positions, &positions)) {
+		return false;
+	}
+
+	for (auto& p : positions) {
+		if (std::find(out_positions.begin(), out_positions.end(), p) == out_positions.end()) {
+			out_positions.push_back(p);
+		}
+	}
+	return true;
+}
+
+bool NABE_DatabaseHandler::AddJobs(const std::string& map_name, const std::vector<std::pair<Vector, Vector>>& positions, int priority)
+{
+	auto table = m_jobs_tables_by_map.find(map_name);
+	if (table == m_jobs_tables_by_map.end()) {
+		return false;
+	}
+
+	if (!SqlQuery("BEGIN;", NULL)) {
+		return false;
+	}
+
+	const auto epoch = GetEpoch();
+	NabeJob job;
+	job.table = table->second;
+	for (auto& p : positions) {
+		job.pos_from = p.first;
+		job.pos_to = p.second;
+		if (SolutionExists(job)) {
+			continue;
+		}
+
+		snprintf(m_query.data(), m_query.size(), "INSERT OR IGNORE INTO %s "
+			"(epoch, from_area_x, from_area_y, from_area_z, to_area_x, to_area_y, to_area_z, priority) "
+			"VALUES (%zd, %.1f, %.1f, %.1f, %.1f, %.1f, %.1f, %d);",
+			table->second.c_str(),
+			epoch,
+			job.pos_from.x, job.pos_from.y, job.pos_from.z,
+			job.pos_to.x, job.pos_to.y, job.pos_to.z,
+			priority);
+		SqlQuery(m_query.data(), NULL);
+	}
+
+	return SqlQuery("COMMIT;", NULL);
+}
+
+void NABE_DatabaseHandler::Debug_AddJob(const NABE_GameMap* map, const Vector& pos_from, const Vector& pos_to)
+{
+	constexpr auto schema = "INSERT INTO %s_%zd_%s "
+		"(epoch, from_area_x, from_area_y, from_area_z, to_area_x, to_area_y, to_area_z) "
+		"VALUES (%zd, %.1f, %.1f, %.1f, %.1f, %.1f, %.1f);";
+
+	constexpr size_t query_max_size = 1024;
+	char query[query_max_size]{ 0 };
+	snprintf(query, query_max_size, schema,
+		jobs_table_identifier,
+		map->map_size,
+		map->map_name.c_str(),
+		GetEpoch(),
+		pos_from.x, pos_from.y, pos_from.z,
+		pos_to.x, pos_to.y, pos_to.z);
+
+	SqlQuery(query, NULL);
+}
+
+std::string NABE_DatabaseHandler::GetMapNameFromTable(const std::string& table_name)
+{
+	std::string map_name_buffer{ table_name };
+	auto id_ext_pos = map_name_buffer.find(jobs_table_identifier);
+	if (id_ext_pos != std::string::npos) {
+		map_name_buffer.replace(id_ext_pos, strlen(jobs_table_identifier) + 1, "");
+	}
+	auto filesize_end_pos = map_name_buffer.find("_");
+	if (filesize_end_pos != std::string::npos) {
+		map_name_buffer.replace(0, filesize_end_pos + 1, "");
+	}
+	return map_name_buffer;
+}
+
+std::string NABE_DatabaseHandler::GetSolutionsTable(const std::string& jobs_table)
+{
+	std::string solutions_table{ jobs_table };
+	auto id_ext_pos = solutions_table.find(jobs_table_identifier);
+	if (id_ext_pos != std::string::npos) {
+		solutions_table.replace(id_ext_pos, strlen(jobs_table_identifier), solutions_table_identifier);
+	}
+	return solutions_table;
+}
+
+std::string NABE_DatabaseHandler::GetAreaSolutionsTable(const std::string& jobs_table)
+{
+	std::string area_solutions_table{ jobs_table };
+	auto id_ext_pos = area_solutions_table.find(jobs_table_identifier);
+	if (id_ext_pos != std::string::npos) {
+		area_solutions_table.replace(id_ext_pos, strlen(jobs_table_identifier), area_solutions_table_identifier);
+	}
+	return area_solutions_table;
+}
+
+std::string NABE_DatabaseHandler::GetBlockedAreasTable(const std::string& jobs_table)
+{
+	std::string blocked_areas_table{ jobs_table };
+	auto id_ext_pos = blocked_areas_table.find(jobs_table_identifier);
+	if (id_ext_pos != std::string::npos) {
+		blocked_areas_table.replace(id_ext_pos, strlen(jobs_table_identifier), blocked_areas_table_identifier);
+	}
+	return blocked_areas_table;
+}
+
+std::string NABE_DatabaseHandler::GetDangerTable(const std::string& jobs_table)
+{
+	std::string danger_table{ jobs_table };
+	auto id_ext_pos = danger_table.find(jobs_table_identifier);
+	if (id_ext_pos != std::string::npos) {
+		danger_table.replace(id_ext_pos, strlen(jobs_table_identifier), danger_table_identifier);
+	}
+	return danger_table;
+}
+
+bool NABE_DatabaseHandler::ColumnExists(const char* table, const char* column, bool& out_exists)
+{
+	constexpr size_t query_max_size = 1024;
+	char query[query_max_size]{ 0 };
+	snprintf(query, query_max_size, "SELECT count(*) FROM pragma_table_info('%s') WHERE name = '%s';",
+		table, column);
+
+	out_exists = false;
+	return SqlQuery(query, &callback_bool, &out_exists);
+}
+
+bool NABE_DatabaseHandler::AddColumnIfNotExists(const char* table, const char* column, const char* definition)
+{
+	bool column_exists = false;
+	if (!ColumnExists(table, column, column_exists)) {
+		return false;
+	}
+	if (column_exists) {
+		return true;
+	}
+
+	constexpr size_t query_max_size = 1024;
+	char query[query_max_size]{ 0 };
+	snprintf(query, query_max_size, "ALTER TABLE %s ADD COLUMN %s %s;", table, column, definition);
+	return SqlQuery(query, NULL);
+}
+
+bool NABE_DatabaseHandler::TableExists(const char* table_identifier, const NABE_GameMap* map)
+{
+	if (!map) {
+		print(Error, "%s: !map", __FUNCTION__);
+		return false;
+	}
+
+	constexpr size_t query_max_size = 1024;
+	char query[query_max_size]{ 0 };
+	snprintf(query, query_max_size, "SELECT count(*) FROM sqlite_master WHERE type='table' AND name ='%s_%zd_%s';",
+		table_identifier,
+		map->map_size,
+		map->map_name.c_str());
+
+	bool table_exists = false;
+	SqlQuery(query, &callback_bool, &table_exists);
+
+	return table_exists;
+}
+
+bool NABE_DatabaseHandler::SolutionExists(const NabeJob& job)
+{
+	snprintf(m_query.data(), m_query.size(), "SELECT EXISTS(SELECT * FROM %s WHERE "
+		"from_area_x = %.1f AND from_area_y = %.1f AND from_area_z = %.1f AND "
+		"to_area_x = %.1f AND to_area_y = %.1f AND to_area_z = %.1f AND "
+		"avoid_attributes = %d AND allow_attributes = %d AND safest = %d AND team = %d AND "
+		"round_time = %d AND seek_enemy = %d);",
+		GetSolutionsTable(job.table).c_str(),
+		job.pos_from.x, job.pos_from.y, job.pos_from.z,
+		job.pos_to.x, job.pos_to.y, job.pos_to.z,
+		job.route.avoid_attributes, job.route.allow_attributes, job.route.safest ? 1 : 0, job.route.team,
+		job.route.round_time, job.route.seek_enemy ? 1 : 0);
+
+	bool solution_exists = false;
+	SqlQuery(m_query.data(), &callback_bool, &solution_exists);
+	return solution_exists;
+}
+
+void NABE_DatabaseHandler::EncodeWaypointDeltas(const std::vector<Vector>& waypoints, std::string& out_deltas)
+{
+	// Whole tenths of a unit, rounded like the "%.1f" of the other position columns. The deltas are taken between
+	// the rounded positions, so that adding them up gives back exactly the rounded waypoints, without drifting.
+	auto tenths = [](float value) { return static_cast<long long>(std::nearbyint(static_cast<double>(value) * 10.0)); };
+	auto append = [&out_deltas](long long delta) {
+		char buffer[32];
+		if (delta % 10 == 0) {
+			snprintf(buffer, sizeof(buffer), "%lld", delta / 10);
+		}
+		else {
+			snprintf(buffer, sizeof(buffer), "%.1f", delta / 10.0);
+		}
+		out_deltas += buffer;
+	};
+
+	for (size_t i = 1; i < waypoints.size(); ++i) {
+		if (i != 1) {
+			out_deltas += ';';
+		}
+		append(tenths(waypoints[i].x) - tenths(waypoints[i - 1].x));
+		out_deltas += ',';
+		append(tenths(waypoints[i].y) - tenths(waypoints[i - 1].y));
+		out_deltas += ',';
+		append(tenths(waypoints[i].z) - tenths(waypoints[i - 1].z));
+	}
+}
+
+void NABE_DatabaseHandler::InsertSolution(const std::string& table, const NABE_Job& job, const std::vector<Vector>& waypoints, bool is_partial)
+{
+	if (waypoints.empty()) {
+		return;
+	}
+
+	const auto& pos_from = job.pos_from;
+	const auto& pos_to = job.pos_to;
+	const auto& route = job.route;
+
+	// The positions only have room for one solution, so replace any solved with other route options.
+	snprintf(m_query.data(), m_query.size(), "DELETE FROM %s WHERE "
+		"from_area_x = %.1f AND from_area_y = %.1f AND from_area_z = %.1f AND "
+		"to_area_x = %.1f AND to_area_y = %.1f AND to_area_z = %.1f AND "
+		"(avoid_attributes != %d OR allow_attributes != %d OR safest != %d OR team != %d OR "
+		"round_time != %d OR seek_enemy != %d);",
+		GetSolutionsTable(table).c_str(),
+		pos_from.x, pos_from.y, pos_from.z,
+		pos_to.x, pos_to.y, pos_to.z,
+		route.avoid_attributes, route.allow_attributes, route.safest ? 1 : 0, route.team,
+		route.round_time, route.seek_enemy ? 1 : 0);
+	SqlQuery(m_query.data(), NULL);
+
+	// In compact mode, the first waypoint is the only row, and carries the rest of the waypoints as deltas.
+	std::string deltas{ "NULL" };
+	if (m_settings.compact_solutions) {
+		deltas = "'";
+		EncodeWaypointDeltas(waypoints, deltas);
+		deltas += "'";
+	}
+
+	std::string query{ "INSERT INTO " };
+	query += GetSolutionsTable(table);
+
+	size_t i = 0;
+	constexpr size_t append_max_size = 1024;
+	char append[append_max_size]{ 0 };
+	auto epoch = GetEpoch();
+	for (auto& p : waypoints) {
+		if (i == 0) {
+			snprintf(append, append_max_size, " SELECT %zd AS 'epoch', %.1f AS 'from_area_x', %.1f AS 'from_area_y', %.1f AS 'from_area_z', "
+				"%.1f AS 'to_area_x', %.1f AS 'to_area_y', %.1f AS 'to_area_z', %zd AS 'step_num', "
+				"%.1f AS 'pass_area_x', %.1f AS 'pass_area_y', %.1f AS 'pass_area_z', %d AS 'is_partial', "
+				"%d AS 'avoid_attributes', %d AS 'allow_attributes', %d AS 'safest', %d AS 'team', "
+				"%d AS 'round_time', %d AS 'seek_enemy', ",
+				epoch,
+				pos_from.x, pos_from.y, pos_from.z,
+				pos_to.x, pos_to.y, pos_to.z,
+				i,
+				p.x, p.y, p.z,
+				is_partial ? 1 : 0,
+				route.avoid_attributes, route.allow_attributes, route.safest ? 1 : 0, route.team,
+				route.round_time, route.seek_enemy ? 1 : 0);
+			query += append;
+			query += deltas;
+			query += " AS 'waypoint_deltas'";
+			if (m_settings.compact_solutions) {
+				break;
+			}
+		}
+		else {
+			snprintf(append, append_max_size, " UNION ALL SELECT %zd, %.1f, %.1f, %.1f, %.1f, %.1f, %.1f, %zd, %.1f, %.1f, %.1f, %d, %d, %d, %d, %d, %d, %d, NULL",
+				epoch,
+				pos_from.x, pos_from.y, pos_from.z,
+				pos_to.x, pos_to.y, pos_to.z,
+				i,
+				p.x, p.y, p.z,
+				is_partial ? 1 : 0,
+				route.avoid_attributes, route.allow_attributes, route.safest ? 1 : 0, route.team,
+				route.round_time, route.seek_enemy ? 1 : 0);
+			query += append;
+		}
+		++i;
+	}
+	query += ';';
+
+	SqlQuery(query.c_str(), NULL);
+}
+
+void NABE_DatabaseHandler::PollBlockedAreas()
+{
+	const auto now = std::chrono::steady_clock::now();
+	if (now - m_last_blocked_poll < std::chrono::milliseconds(m_settings.blocked_poll_interval_ms)) {
+		return;
+	}
+	m_last_blocked_poll = now;
+
+	// Rows updated during this same second may still follow, so they're read again on the next poll.
+	// Reapplying a state is harmless, since only actual changes are applied.
+	const auto epoch = GetEpoch();
+	std::vector<std::pair<Vector, bool>> rows;
+	std::vector<std::pair<int, bool>> area_states;
+	for (auto& table : m_jobs_tables_by_map) {
+		snprintf(m_query.data(), m_query.size(), "SELECT area_x, area_y, area_z, blocked FROM %s WHERE epoch >= %zd;",
+			GetBlockedAreasTable(table.second).c_str(), m_blocked_epoch);
+
+		rows.clear();
+		if (!SqlQuery(m_query.data(), &callback_blocked_areas, &rows) || rows.empty()) {
+			continue;
+		}
+
+		area_states.clear();
+		for (auto& row : rows) {
+			int area_id;
+			if (!m_pathfinder->ResolveArea(table.first, row.first, area_id)) {
+				print(Warning, "%s: %s: No nav area at (%.1f %.1f %.1f)", __FUNCTION__, table.first.c_str(),
+					row.first.x, row.first.y, row.first.z);
+				continue;
+			}
+			area_states.emplace_back(area_id, row.second);
+		}
+
+		const auto num_changed = m_pathfinder->SetAreasBlocked(table.first, area_states);
+		if (m_verbosity && num_changed != 0) {
+			print(Info, "%s: %s: %zd areas changed their blocked state", __FUNCTION__, table.first.c_str(), num_changed);
+		}
+	}
+	m_blocked_epoch = epoch;
+}
+
+void NABE_DatabaseHandler::PollDanger()
+{
+	const auto now = std::chrono::steady_clock::now();
+	if (now - m_last_danger_poll < std::chrono::milliseconds(m_settings.danger_poll_interval_ms)) {
+		return;
+	}
+	m_last_danger_poll = now;
+
+	// Events are read once, in the order they were reported, and fade by however long ago they happened.
+	// Events old enough to have faded out are deleted, so the tables stay small without any bookkeeping
+	// of which worker has read what.
+	const auto half_life = m_pathfinder->GetDangerHalfLife();
+	const auto epoch = GetEpoch();
+	std::vector<DangerRow> rows;
+	std::vector<NABE_DangerEvent> events;
+	for (auto& table : m_jobs_tables_by_map) {
+		const auto danger_table = GetDangerTable(table.second);
+		auto& last_id = m_danger_ids[danger_table];
+
+		snprintf(m_query.data(), m_query.size(), "SELECT id, epoch, area_x, area_y, area_z, team, amount FROM %s "
+			"WHERE id > %lld ORDER BY id;",
+			danger_table.c_str(), last_id);
+
+		rows.clear();
+		if (!SqlQuery(m_query.data(), &callback_danger, &rows) || rows.empty()) {
+			continue;
+		}
+		last_id = rows.back().id;
+
+		events.clear();
+		for (auto& row : rows) {
+			NABE_DangerEvent event;
+			if (!m_pathfinder->ResolveArea(table.first, row.pos, event.area_id)) {
+				print(Warning, "%s: %s: No nav area at (%.1f %.1f %.1f)", __FUNCTION__, table.first.c_str(),
+					row.pos.x, row.pos.y, row.pos.z);
+				continue;
+			}
+			const auto age = (epoch > row.epoch) ? static_cast<float>(epoch - row.epoch) : 0.0f;
+			event.team = row.team;
+			event.amount = row.amount * NABE_DangerField::GetDecayFactor(age, half_life);
+			events.push_back(event);
+		}
+
+		const auto num_applied = m_pathfinder->AddDanger(table.first, m_danger_layer, events);
+		if (m_verbosity) {
+			print(Info, "%s: %s: Applied %zd danger events", __FUNCTION__, table.first.c_str(), num_applied);
+		}
+
+		if (half_life > 0) {
+			// Faded below 1/65536 of their strength.
+			const auto max_age = static_cast<size_t>(16 * half_life);
+			snprintf(m_query.data(), m_query.size(), "DELETE FROM %s WHERE epoch < %zd;",
+				danger_table.c_str(), (epoch > max_age) ? epoch - max_age : 0);
+			SqlQuery(m_query.data(), NULL);
+		}
+	}
+}
+
+void NABE_DatabaseHandler::IncrementalVacuum()
+{
+	snprintf(m_query.data(), m_query.size(), "PRAGMA incremental_vacuum(%d);", m_settings.tuning.incremental_vacuum_pages);
+	SqlQuery(m_query.data(), NULL);
+}
+
+bool NABE_DatabaseHandler::DeleteJob(const std::string& table, long long rowid)
+{
+	snprintf(m_query.data(), m_query.size(), "DELETE FROM %s WHERE rowid = %lld AND claimed_by = %s;",
+		table.c_str(),
+		rowid,
+		m_worker_id_sql_literal.c_str());
+	return SqlQuery(m_query.data(), NULL) && sqlite3_changes(m_db) == 1;
+}
+
+bool NABE_DatabaseHandler::GetAreaSolution(const char* area_solutions_table, int area_id_from, int area_id_to,
+	std::vector<int>& out_area_ids)
+{
+	out_area_ids.clear();
+
+	constexpr size_t query_max_size = 1024;
+	char query[query_max_size]{ 0 };
+	snprintf(query, query_max_size, "SELECT pass_area_id FROM %s "
+		"WHERE from_area_id = %d AND to_area_id = %d ORDER BY step_num;",
+		area_solutions_table, area_id_from, area_id_to);
+
+	if (!SqlQuery(query, &callback_area_solution_steps, &out_area_ids)) {
+		out_area_ids.clear();
+		return false;
+	}
+	return !out_area_ids.empty();
+}
+
+void NABE_DatabaseHandler::InsertAreaSolution(const char* area_solutions_table, int area_id_from, int area_id_to,
+	const std::list<CNavArea*>& solution)
+{
+	if (solution.empty()) {
+		return;
+	}
+
+	// A shorter path than the stored one only replaces its first steps, so remove the rest of it first.
+	// This runs inside the batch's transaction, so readers never see the pair without a path.
+	std::string query{ "DELETE FROM " };
+	query += area_solutions_table;
+	query += " WHERE from_area_id = " + std::to_string(area_id_from) + " AND to_area_id = " + std::to_string(area_id_to) + ";";
+	if (!SqlQuery(query.c_str(), NULL)) {
+		return;
+	}
+
+	query = "INSERT OR REPLACE INTO ";
+	query += area_solutions_table;
+	query += " (epoch, from_area_id, to_area_id, step_num, pass_area_id) VALUES ";
+
+	constexpr size_t append_max_size = 128;
+	char append[append_max_size]{ 0 };
+	const auto epoch = GetEpoch();
+	size_t i = 0;
+	for (auto& p : solution) {
+		snprintf(append, append_max_size, "%s(%zd, %d, %d, %zd, %u)",
+			(i == 0 ? "" : ", "), epoch, area_id_from, area_id_to, i, p->GetID());
+		query += append;
+		++i;
+	}
+	query += ';';
+
+	SqlQuery(query.c_str(), NULL);
+}
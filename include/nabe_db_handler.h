@@ -4,476 +4,249 @@
 #include "thirdparty/sqlite-amalgamation/sqlite3.h"
 
 #include "print_helpers.h"
+#include "nabe_batch_controller.h"
 #include "nabe_gamemap.h"
-#include "nabe_pathfinder.h"
+#include "nabe_job_source.h"
 
 #include <chrono>
 #include <list>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+class NABE_PathFinder;
+
+// Purpose: Optional connection settings for the job database. The defaults leave SQLite's own defaults untouched.
+struct NABE_DatabaseTuning {
+	// Use write-ahead logging, so that the game server's reads and our writes don't block each other.
+	// This is a persistent property of the database file, and applies to every connection using it.
+	bool journal_mode_wal = false;
+	// Only sync at WAL checkpoints instead of every commit. Safe from corruption in WAL mode.
+	bool synchronous_normal = false;
+	// Bytes of the database to access through memory mapped I/O. 0 to disable.
+	long long mmap_size = 0;
+	// Page cache size in KiB. 0 to use the SQLite default.
+	long long cache_size_kb = 0;
+	// Reclaim free pages a few at a time while idle, instead of a full VACUUM.
+	bool incremental_vacuum = false;
+	// Max number of free pages to reclaim per idle loop.
+	int incremental_vacuum_pages = 64;
+	// Max total time to keep retrying a busy database, before giving up on the query.
+	int busy_timeout_ms = 1000;
+};
 
-// Will wait for this many seconds between pathfinding runs.
-static constexpr int LOOP_SLEEP_SECONDS = 1;
-static constexpr auto jobs_table_identifier = "nabejobs";
-static constexpr auto solutions_table_identifier = "nabesols";
+// Purpose: Settings of a single SourceMod job database.
+struct NABE_DatabaseSettings {
+	std::string location;
 
-static bool job_table_exists = false;
-static bool solution_table_exists = false;
-static sqlite3* db = nullptr;
+	// Retry at most this many times if the db was busy.
+	size_t max_retries = 10;
 
-static fs::path _map_folder_path;
-static NABE_PathFinder* ptr_pathfinder = nullptr;
-static size_t num_jobs_completed_this_loop = 0;
+	// We can't handle too large batches at a time, because it can hang the SourceMod side if the
+	// SM db handle needs to perform a task that doesn't have multithreaded implementation.
+	// And this would hang the actual game server, also.
+	// If adaptive, the batch size is adjusted between loops according to how contended the database was,
+	// between the min and max.
+	size_t max_solves_at_once = 50;
+	bool adaptive_batch_size = false;
+	size_t min_solves_at_once = 1;
+	double target_commit_ms = 20;
 
-// Retry this many time if the db was busy.
-static size_t _max_retries = 0;
+	// Jobs are claimed by writing our worker id to them before solving, so that several nabe processes
+	// can safely drain the same database. Claims older than the lease are considered abandoned,
+	// (eg. the worker crashed) and can be claimed by anyone.
+	std::string worker_id;
+	size_t claim_lease_seconds = 60;
 
-// Whether to print some extra informational debug.
-static bool _solver_verbosity = false;
+	// Whether to also store solutions keyed by nav area ids, instead of just the exact job positions.
+	// Any later job resolving to the same pair of areas can then be answered without solving.
+	bool persist_area_solutions = false;
 
-// We can't handle too large batches at a time, because it can hang the SourceMod side if the
-// SM db handle needs to perform a task that doesn't have multithreaded implementation.
-// And this would hang the actual game server, also.
-static size_t _max_solves_at_once = 1;
+	// How often to read the blocked areas (doors, obstacles) reported by the game server, in milliseconds.
+	// Changes are applied between batches, all of a poll's changes at once. 0 disables the blocked areas tables.
+	size_t blocked_poll_interval_ms = 0;
 
-typedef int (*sql_callback)(void* not_used, int argc, char** argv, char** az_col_name);
-struct NabePendingSqlJob {
-	std::string query;
-	std::string table;
-	sql_callback callback;
-};
-std::list<NabePendingSqlJob> pending_sql_queries;
-static std::string* current_table;
-static std::list<std::pair<NABE_GameMap*, std::pair<int, int>>> pending_paths_to_solve;
+	// How often to read the danger events (kills, damage) reported by the game server, in milliseconds.
+	// 0 disables the danger tables.
+	size_t danger_poll_interval_ms = 0;
 
-static char* _query = nullptr;
-static constexpr size_t _query_max_size = 100 * 1024;
+	// Whether to store each solution as a single row, with the waypoints after the first one delta encoded in its
+	// waypoint_deltas column (see NABE_DatabaseHandler::EncodeWaypointDeltas), instead of a row per waypoint.
+	bool compact_solutions = false;
 
-static void AddPendingSqlQuery(const char* sql_query, const char* table_name, const sql_callback sqlite_cb)
-{
-	NabePendingSqlJob query;
-	query.query = sql_query;
-	query.table = table_name;
-	query.callback = sqlite_cb;
-	pending_sql_queries.push_back(query);
-}
-
-static bool SqlQuery(const char* sql_query, const sql_callback sqlite_cb)
-{
-	char* error_msg = nullptr;
-	if (sqlite3_exec(db, sql_query, sqlite_cb, 0, &error_msg) != SQLITE_OK) {
-		print(Error, "SQL error:\t%s", error_msg);
-		sqlite3_free(error_msg);
-		return false;
-	}
-	return true;
-}
-
-static int callback_job_table_exists(void*, int argc, char** argv, char** az_col_name)
-{
-	const bool sql_success = (argc == 1 && *argv[0]);
-	job_table_exists = (sql_success && (atoi(argv[0]) == 1));
-	return sql_success ? SQLITE_OK : SQLITE_ERROR;
-}
+	// Whether each map of this database may only be solved by one nabe process at a time (see NABE_MapLock).
+	bool exclusive_maps = true;
 
-static int callback_solution_table_exists(void*, int argc, char** argv, char** az_col_name)
-{
-	const bool sql_success = (argc == 1 && *argv[0]);
-	solution_table_exists = (sql_success && (atoi(argv[0]) == 1));
-	return sql_success ? SQLITE_OK : SQLITE_ERROR;
-}
+	bool create_db_if_not_exists = false;
 
-static int callback_handle_map_jobs(void*, int argc, char** argv, char** az_col_name);
+	NABE_DatabaseTuning tuning;
+};
 
-static int callback_get_jobs(void*, int argc, char** argv, char** az_col_name)
-{
-	if (argc != 5) {
-		return SQLITE_ERROR;
-	}
-
-	constexpr size_t query_max_size = 1024;
-	char query[query_max_size]{ 0 };
-	snprintf(query, query_max_size, "SELECT from_area_x, from_area_y, from_area_z, "
-		"to_area_x, to_area_y, to_area_z "
-		"FROM %s "
-		"ORDER BY epoch DESC " // return newest results first, since those are probably most relevant to solve
-		"LIMIT %zd;", // see comment about reasoning for limit above
-		
-		argv[2], _max_solves_at_once);
-
-	AddPendingSqlQuery(query, argv[2], &callback_handle_map_jobs);
-
-	return SQLITE_OK;
-}
-
-static bool solution_exists = false;
-static int callback_solution_exists(void*, int argc, char** argv, char** az_col_name)
-{
-	solution_exists = ((argc == 1) && (atoi(argv[0]) == 1));
-	return SQLITE_OK;
-}
+// Purpose: State of the busy handler, passed to SQLite as the handler's user data.
+struct NABE_BusyHandlerState {
+	// Budget for a single busy lock.
+	size_t max_retries = 0;
+	int timeout_ms = 1000;
+	int waited_ms = 0;
 
-static int sqlite_busy_handler(void* data, int num)
-{
-	static auto num_tries = _max_retries;
-	num_tries -= num;
-
-	if (num_tries <= 0) {
-		num_tries = _max_retries;
-		print(Warning, "DB was busy. Gave up after %d retries.", _max_retries);
-		return 0;
-	}
-	else {
-		constexpr auto milliseconds_in_one_second = 1000;
-		constexpr auto busy_sleep_seconds = 1;
-		sqlite3_sleep(busy_sleep_seconds * milliseconds_in_one_second);
-	}
-
-	//print(Info, "DB was busy, trying again. Previous attempts: %d", num);
-	return static_cast<int>(_max_retries);
-}
-
-// Return Unix epoch
-size_t GetEpoch()
-{
-	return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock().now().time_since_epoch()).count();
-}
+	// Stats for the current loop, see NABE_DatabaseHandler::ReportBusyStats.
+	size_t num_waits = 0;
+	size_t num_timeouts = 0;
+	int total_waited_ms = 0;
 
-class NABE_DatabaseHandler
+	std::minstd_rand rng{ std::random_device{}() };
+};
+
+// Purpose: Job source and result sink for the job tables of a SourceMod SQLite database.
+class NABE_DatabaseHandler : public NABE_JobSource, public NABE_ResultSink
 {
 public:
-	NABE_DatabaseHandler(NABE_PathFinder* pathfinder, const char* db_path, const char* map_folder_path,
-		size_t max_retries, bool solver_verbosity, size_t max_solves_at_once,
-		bool create_db_if_not_exists = false)
-	{
-		if (_query != nullptr) {
-			print(Error, "%s: Query variable is leaking memory", __FUNCTION__);
-			return;
-		}
-		else {
-			_query = new char[_query_max_size];
-		}
+	NABE_DatabaseHandler(NABE_PathFinder* pathfinder, const NABE_DatabaseSettings& settings, bool verbosity);
+	~NABE_DatabaseHandler();
 
-		ptr_pathfinder = pathfinder;
-		_map_folder_path = map_folder_path;
-		_max_retries = max_retries;
-		_solver_verbosity = solver_verbosity;
-		_max_solves_at_once = max_solves_at_once;
+	NABE_DatabaseHandler(const NABE_DatabaseHandler&) = delete;
+	NABE_DatabaseHandler& operator=(const NABE_DatabaseHandler&) = delete;
 
-		if (!fs::exists(fs::path(db_path)) && !create_db_if_not_exists) {
-			print(Error, "%s:  Database path doesn't exist: \"%s\"", __FUNCTION__, db_path);
-			return;
-		}
+	// Open the database, and apply the connection settings. Must be called before adding any maps.
+	bool Open();
 
-		print(Info, "Opening SQLite database location: \"%s\"", db_path);
-		if (sqlite3_open(db_path, &db) != SQLITE_OK) {
-			print(Error, "%s: Can't open database: %s", __FUNCTION__, sqlite3_errmsg(db));
-			sqlite3_close(db);
-			return;
-		}
+	bool AddMap(const NABE_GameMap* map);
 
-		sqlite3_busy_handler(db, &sqlite_busy_handler, NULL);
+	const NABE_DatabaseSettings& GetSettings() const { return m_settings; }
 
-		print(Info, "Cleaning up any dirty navigation data from database...");
-		sqlite3_exec(db, "VACUUM", 0, 0, 0);
-	}
+	// NABE_JobSource
+	// Fetch the next batch of jobs across all of the maps' jobs tables.
+	void FetchJobs(std::vector<NABE_Job>& out_jobs) override;
+	void OnIdle() override;
 
-	~NABE_DatabaseHandler()
-	{
-		print(Info, "Cleaning up any dirty navigation data from database...");
-		sqlite3_exec(db, "VACUUM", 0, 0, 0);
+	// NABE_ResultSink
+	bool LookupPath(const NABE_Job& job, int area_id_from, int area_id_to, std::list<CNavArea*>& out_path) override;
+	// All of a batch's writes are committed in a single transaction.
+	void BeginResults() override;
+	void WriteResult(const NABE_Job& job, const NABE_JobResult& result) override;
+	void EndResults() override;
 
-		print(Info, "Closing database connection...");
-		sqlite3_close(db);
+	bool HasMap(const std::string& map_name) const { return m_jobs_tables_by_map.count(map_name) != 0; }
 
-		delete[] _query;
-		_query = nullptr;
-	}
+	// Positions of a map's most recently solved jobs, most recent first, without duplicates.
+	bool GetRecentPositions(const std::string& map_name, size_t max_num_solutions, std::vector<Vector>& out_positions);
+	// Queue jobs for the pairs of positions that don't have a solution yet. Jobs that already exist are left as is.
+	bool AddJobs(const std::string& map_name, const std::vector<std::pair<Vector, Vector>>& positions, int priority);
 
-	void HandlePendingQueries()
-	{
-		for (auto& p : pending_sql_queries) {
-			current_table = &p.table;
-			SqlQuery(p.query.c_str(), p.callback);
-		}
-		pending_sql_queries.clear();
-	}
-
-	// Wait, so that we don't needlessly spend cycles when there's no work.
-	void Sleep()
-	{
-		// Only sleep if there haven't been any pathfinding jobs for us recently.
-		if (num_jobs_completed_this_loop == 0) {
-			constexpr auto milliseconds_in_one_second = 1000;
-			sqlite3_sleep(LOOP_SLEEP_SECONDS * milliseconds_in_one_second);
-		}
-	}
+	void Debug_AddJob(const NABE_GameMap* map, const Vector& pos_from, const Vector& pos_to);
 
-	bool AddMap(const NABE_GameMap* map)
-	{
-		if (!db) {
-			print(Error, "%s: Database is not open.", __FUNCTION__);
-			return false;
-		}
+	// Extract map name from a jobs table name
+	static std::string GetMapNameFromTable(const std::string& table_name);
+	static std::string GetSolutionsTable(const std::string& jobs_table);
+	static std::string GetAreaSolutionsTable(const std::string& jobs_table);
+	static std::string GetBlockedAreasTable(const std::string& jobs_table);
+	static std::string GetDangerTable(const std::string& jobs_table);
 
-		// Jobs table
-		{
-			constexpr auto schema =
-				"CREATE TABLE IF NOT EXISTS %s_%zd_%s(\n"
-				"\tepoch INTEGER NOT NULL,\n"
-				"\tfrom_area_x REAL NOT NULL,\n"
-				"\tfrom_area_y REAL NOT NULL,\n"
-				"\tfrom_area_z REAL NOT NULL,\n"
-				"\tto_area_x REAL NOT NULL,\n"
-				"\tto_area_y REAL NOT NULL,\n"
-				"\tto_area_z REAL NOT NULL,\n"
-				"\tUNIQUE (from_area_x, from_area_y, from_area_z, "
-				"to_area_x, to_area_y, to_area_z)\n);";
-
-			constexpr size_t query_max_size = 1024;
-			char query[query_max_size]{ 0 };
-			snprintf(query, query_max_size, schema,
-				jobs_table_identifier,
-				map->map_size,
-				map->map_name.c_str());
-
-			SqlQuery(query, NULL);
-
-			if (!JobTableExists(map)) {
-				print(Error, "%s: Failed to create job table", __FUNCTION__);
-				return false;
-			}
-			else {
-				if (_solver_verbosity) {
-					print(Info, "%s: Job table exists for: %s", __FUNCTION__, map->map_name.c_str());
-				}
-			}
-		}
+	// Append the waypoints after the first as "dx,dy,dz;dx,dy,dz;...", each the offset from the previous waypoint,
+	// in units rounded to a tenth (and without the decimal, if it's zero).
+	static void EncodeWaypointDeltas(const std::vector<Vector>& waypoints, std::string& out_deltas);
 
-		// Solution tables
+private:
+	// A single job row, as read from one of the jobs tables.
+	struct NabeJob {
+		std::string table;
+		long long rowid = 0;
+		Vector pos_from;
+		Vector pos_to;
+		NABE_RouteOptions route;
+	};
+
+	// A job waiting for dispatch in the global (cross-map) job queue.
+	// Higher priority first, then newer epoch first, since those are probably most relevant to solve.
+	// Ties are broken by the job's rank within its own map's table, so that maps take turns.
+	struct NabeScheduledJob {
+		NabeJob job;
+		int priority;
+		size_t epoch;
+		size_t rank;
+
+		bool operator<(const NabeScheduledJob& other) const
 		{
-			constexpr auto schema =
-				"CREATE TABLE IF NOT EXISTS %s_%zd_%s(\n"
-				"\tepoch INTEGER NOT NULL,\n"
-				"\tfrom_area_x REAL NOT NULL,\n"
-				"\tfrom_area_y REAL NOT NULL,\n"
-				"\tfrom_area_z REAL NOT NULL,\n"
-				"\tto_area_x REAL NOT NULL,\n"
-				"\tto_area_y REAL NOT NULL,\n"
-				"\tto_area_z REAL NOT NULL,\n"
-				"\tstep_num INTEGER NOT NULL,\n"
-				"\tpass_area_x REAL NOT NULL,\n"
-				"\tpass_area_y REAL NOT NULL,\n"
-				"\tpass_area_z REAL NOT NULL,\n"
-				"\tUNIQUE(from_area_x, from_area_y, from_area_z, "
-				"to_area_x, to_area_y, to_area_z, step_num)\n);";
-
-			constexpr size_t query_max_size = 1024;
-			char query[query_max_size]{ 0 };
-			snprintf(query, query_max_size, schema,
-				solutions_table_identifier,
-				map->map_size,
-				map->map_name.c_str());
-
-			SqlQuery(query, NULL);
-
-			if (!SolutionsTableExists(map)) {
-				print(Error, "%s: Failed to create solution table", __FUNCTION__);
-				return false;
+			if (priority != other.priority) {
+				return priority < other.priority;
 			}
-			else {
-				if (_solver_verbosity) {
-					print(Info, "%s: Solutions table exists for: %s", __FUNCTION__, map->map_name.c_str());
-				}
+			if (epoch != other.epoch) {
+				return epoch < other.epoch;
 			}
+			return rank > other.rank;
 		}
+	};
 
-		return true;
-	}
-
-	void GetJobs()
-	{
-		num_jobs_completed_this_loop = 0;
-
-		constexpr size_t query_max_size = 1024;
-		char query[query_max_size]{ 0 };
-		snprintf(query, query_max_size, "SELECT * FROM sqlite_master WHERE type='table' AND name LIKE '%s_%%';",
-			jobs_table_identifier);
-
-		SqlQuery(query, &callback_get_jobs);
-	}
-
-	void Debug_AddJob(const NABE_GameMap* map, const Vector& pos_from, const Vector& pos_to)
-	{
-		constexpr auto schema = "INSERT INTO %s_%zd_%s "
-			"(epoch, from_area_x, from_area_y, from_area_z, to_area_x, to_area_y, to_area_z) "
-			"VALUES (%zd, %.1f, %.1f, %.1f, %.1f, %.1f, %.1f);";
-
-		constexpr size_t query_max_size = 1024;
-		char query[query_max_size]{ 0 };
-		snprintf(query, query_max_size, schema,
-			jobs_table_identifier,
-			map->map_size,
-			map->map_name.c_str(),
-			GetEpoch(),
-			pos_from.x, pos_from.y, pos_from.z,
-			pos_to.x, pos_to.y, pos_to.z);
-
-		SqlQuery(query, NULL);
-	}
-
-	static bool RequestSolve(const char* table_name, const Vector& pos_from, const Vector& pos_to, std::list<CNavArea*>& solution)
-	{
-		if (!ptr_pathfinder) {
-			print(Error, "%s: Pathfinder pointer is null", __FUNCTION__);
-			return false;
-		}
+	typedef int (*sql_callback)(void* data, int argc, char** argv, char** az_col_name);
+	bool SqlQuery(const char* sql_query, const sql_callback sqlite_cb, void* data = nullptr);
 
-		// Extract map name from the table name
-		std::string map_name_buffer{ table_name };
-		auto id_ext_pos = map_name_buffer.find(jobs_table_identifier);
-		if (id_ext_pos != std::string::npos) {
-			map_name_buffer.replace(id_ext_pos, strlen(jobs_table_identifier) + 1, "");
-		}
-		auto filesize_end_pos = map_name_buffer.find("_");
-		if (filesize_end_pos != std::string::npos) {
-			map_name_buffer.replace(0, filesize_end_pos + 1, "");
-		}
-	
-		return ptr_pathfinder->Solve(map_name_buffer, pos_from, pos_to, solution);
-	}
+	bool ApplyTuning();
 
-private:
-	bool JobTableExists(const NABE_GameMap* map)
-	{
-		if (!map) {
-			print(Error, "%s: !map", __FUNCTION__);
-			return false;
-		}
+	// Report how long the previous loop spent waiting for the database lock, and start counting anew.
+	void ReportBusyStats();
 
-		constexpr size_t query_max_size = 1024;
-		char query[query_max_size]{ 0 };
-		snprintf(query, query_max_size, "SELECT count(*) FROM sqlite_master WHERE type='table' AND name ='%s_%zd_%s';",
-			jobs_table_identifier,
-			map->map_size,
-			map->map_name.c_str());
+	bool ColumnExists(const char* table, const char* column, bool& out_exists);
+	// Add a column to an existing table, unless it already has it.
+	bool AddColumnIfNotExists(const char* table, const char* column, const char* definition);
+	bool TableExists(const char* table_identifier, const NABE_GameMap* map);
 
-		SqlQuery(query, &callback_job_table_exists);
+	// Check if solution already exists for the exact positions of this job.
+	bool SolutionExists(const NabeJob& job);
+	void InsertSolution(const std::string& table, const NABE_Job& job, const std::vector<Vector>& waypoints, bool is_partial);
+	// Only deletes the row if we still hold the claim on it. Returns false if we don't.
+	bool DeleteJob(const std::string& table, long long rowid);
 
-		return job_table_exists;
-	}
+	// Reads a stored area-keyed solution. Returns false if there was none.
+	bool GetAreaSolution(const char* area_solutions_table, int area_id_from, int area_id_to, std::vector<int>& out_area_ids);
+	void InsertAreaSolution(const char* area_solutions_table, int area_id_from, int area_id_to,
+		const std::list<CNavArea*>& solution);
 
-	bool SolutionsTableExists(const NABE_GameMap* map)
-	{
-		if (!map) {
-			print(Error, "%s: !map", __FUNCTION__);
-			return false;
-		}
+	// Apply the blocked areas changed since the previous poll, if it's time to poll again.
+	void PollBlockedAreas();
+	// Apply the danger events reported since the previous poll, if it's time to poll again.
+	void PollDanger();
 
-		constexpr size_t query_max_size = 1024;
-		char query[query_max_size]{ 0 };
-		snprintf(query, query_max_size, "SELECT count(*) FROM sqlite_master WHERE type='table' AND name ='%s_%zd_%s';",
-			solutions_table_identifier,
-			map->map_size,
-			map->map_name.c_str());
+	// Reclaim a bounded number of free pages, so a single call never holds the write lock for long.
+	void IncrementalVacuum();
 
-		SqlQuery(query, &callback_solution_table_exists);
+private:
+	NABE_PathFinder* m_pathfinder;
+	NABE_DatabaseSettings m_settings;
+	sqlite3* m_db = nullptr;
 
-		return solution_table_exists;
-	}
-};
+	NABE_BusyHandlerState m_busy_state;
+	NABE_BatchController m_batch_controller;
 
-static int callback_handle_map_jobs(void*, int argc, char** argv, char** az_col_name)
-{
-	const Vector pos_from(
-		static_cast<float>(atof(argv[0])),
-		static_cast<float>(atof(argv[1])),
-		static_cast<float>(atof(argv[2]))
-	);
-
-	const Vector pos_to(
-		static_cast<float>(atof(argv[3])),
-		static_cast<float>(atof(argv[4])),
-		static_cast<float>(atof(argv[5]))
-	);
-
-	if (!pos_from.IsValid() || !pos_to.IsValid()) {
-		print(Error, "%s: Invalid position vectors(s)", __FUNCTION__);
-		return SQLITE_ERROR;
-	}
-
-	if (_solver_verbosity) {
-		print(Info, "%s: %s: Area (%.1f %.1f %.1f) --> (%.1f %.1f %.1f)",
-			__FUNCTION__, current_table->c_str(),
-			pos_from.x, pos_from.y, pos_from.z,
-			pos_to.x, pos_to.y, pos_to.z);
-	}
-
-	std::string solutions_table = *current_table;
-	auto id_ext_pos = solutions_table.find(jobs_table_identifier);
-	if (id_ext_pos != std::string::npos) {
-		solutions_table.replace(id_ext_pos, strlen(jobs_table_identifier), solutions_table_identifier);
-	}
-
-	// Check if solution already exists.
-	snprintf(_query, _query_max_size, "SELECT EXISTS(SELECT * FROM %s WHERE "
-		"from_area_x = %.1f AND from_area_y = %.1f AND from_area_z = %.1f AND "
-		"to_area_x = %.1f AND to_area_y = %.1f AND to_area_z = %.1f);",
-		solutions_table.c_str(),
-		pos_from.x, pos_from.y, pos_from.z,
-		pos_to.x, pos_to.y, pos_to.z);
-	SqlQuery(_query, &callback_solution_exists);
-
-	// No solution cached in database; need to solve this.
-	if (!solution_exists) {
-		std::list<CNavArea*> solution;
-		if (NABE_DatabaseHandler::RequestSolve(current_table->c_str(), pos_from, pos_to, solution)) {
-			snprintf(_query, _query_max_size, "INSERT INTO %s", solutions_table.c_str());
-
-			size_t i = 0;
-			size_t num_passes = solution.size();
-			constexpr size_t append_max_size = 1024;
-			char append[append_max_size]{ 0 };
-			auto epoch = GetEpoch();
-			for (auto& p : solution) {
-				if (i == 0) {
-					snprintf(append, append_max_size, " SELECT %zd AS 'epoch', %.1f AS 'from_area_x', %.1f AS 'from_area_y', %.1f AS 'from_area_z', "
-						"%.1f AS 'to_area_x', %.1f AS 'to_area_y', %.1f AS 'to_area_z', %zd AS 'step_num', "
-						"%.1f AS 'pass_area_x', %.1f AS 'pass_area_y', %.1f AS 'pass_area_z'",
-						epoch,
-						pos_from.x, pos_from.y, pos_from.z,
-						pos_to.x, pos_to.y, pos_to.z,
-						i,
-						p->GetCenter().x, p->GetCenter().y, p->GetCenter().z);
-				}
-				else {
-					snprintf(append, append_max_size, " UNION ALL SELECT %zd, %.1f, %.1f, %.1f, %.1f, %.1f, %.1f, %zd, %.1f, %.1f, %.1f",
-						epoch,
-						pos_from.x, pos_from.y, pos_from.z,
-						pos_to.x, pos_to.y, pos_to.z,
-						i,
-						p->GetCenter().x, p->GetCenter().y, p->GetCenter().z);
-				}
-				snprintf(_query, _query_max_size, "%s%s", _query, append);
-				++i;
-			}
-			snprintf(_query, _query_max_size, "%s%c", _query, ';');
+	// Signals of the previous loop, for adjusting the batch size.
+	double m_last_commit_ms = 0;
+	size_t m_last_backlog = 0;
+	std::chrono::steady_clock::time_point m_commit_start;
 
-			NabePendingSqlJob job;
-			job.query = std::string(_query);
+	std::string m_worker_id_sql_literal;
 
-			SqlQuery(job.query.c_str(), NULL);
-			++num_jobs_completed_this_loop;
-		}
-	}
-
-	// This job is completed, so we can delete the row.
-	snprintf(_query, _query_max_size, "DELETE FROM %s WHERE from_area_x = %.1f AND from_area_y = %.1f AND from_area_z = %.1f AND "
-		"to_area_x = %.1f AND to_area_y = %.1f AND to_area_z = %.1f;",
-		current_table->c_str(),
-		pos_from.x, pos_from.y, pos_from.z,
-		pos_to.x, pos_to.y, pos_to.z);
-	SqlQuery(_query, NULL);
-
-	return SQLITE_OK;
-}
+	std::chrono::steady_clock::time_point m_last_blocked_poll;
+	// Rows of the blocked areas tables updated at or after this epoch haven't been applied yet.
+	size_t m_blocked_epoch = 0;
+
+	std::chrono::steady_clock::time_point m_last_danger_poll;
+	// Danger table rows up to these ids have already been applied, by table name.
+	std::map<std::string, long long> m_danger_ids;
+	// Our game server's danger is kept apart from that of the other databases, see NABE_PathFinder::AddDangerLayer.
+	int m_danger_layer = 0;
+
+	// Jobs tables of all the maps we've been given, by map name.
+	std::vector<std::string> m_jobs_tables;
+	std::map<std::string, std::string> m_jobs_tables_by_map;
+
+	// Area pairs stored to the area-keyed solution tables during the current batch.
+	std::set<std::tuple<std::string, int, int>> m_persisted_this_batch;
+
+	std::vector<char> m_query;
+
+	bool m_verbosity;
+};
 
 #endif // NABENABE_DATABASE_HANDLER_H
@@ -0,0 +1,262 @@
+#include "nabe_first_move_table.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <thread>
+
+static constexpr uint32_t first_move_table_magic = 0x4D46424E; // "NBFM"
+static constexpr uint32_t first_move_table_version = 1;
+
+struct FirstMoveTableFileHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t graph_hash;
+	uint32_t num_areas;
+	uint32_t num_runs;
+};
+
+void NABE_FirstMoveTable::Clear()
+{
+	m_ranks.clear();
+	m_row_offsets.clear();
+	m_run_starts.clear();
+	m_run_moves.clear();
+}
+
+void NABE_FirstMoveTable::BuildOrdering(const NABE_NavGraph& graph)
+{
+	const auto num_areas = static_cast<uint32_t>(graph.GetNumAreas());
+	m_ranks.assign(num_areas, NABE_NavGraph::INVALID_INDEX);
+
+	// Connections are followed both ways, so that one-way drops don't split up neighbourhoods.
+	uint32_t next_rank = 0;
+	std::vector<uint32_t> stack;
+	for (uint32_t root = 0; root < num_areas; ++root) {
+		if (m_ranks[root] != NABE_NavGraph::INVALID_INDEX) {
+			continue;
+		}
+		stack.push_back(root);
+		while (!stack.empty()) {
+			const auto area = stack.back();
+			stack.pop_back();
+			if (m_ranks[area] != NABE_NavGraph::INVALID_INDEX) {
+				continue;
+			}
+			m_ranks[area] = next_rank++;
+			for (auto edge = graph.GetEdgesBegin(area); edge != graph.GetEdgesEnd(area); ++edge) {
+				stack.push_back(graph.GetEdgeTarget(edge));
+			}
+			for (auto edge = graph.GetReverseEdgesBegin(area); edge != graph.GetReverseEdgesEnd(area); ++edge) {
+				stack.push_back(graph.GetReverseEdgeSource(edge));
+			}
+		}
+	}
+}
+
+bool NABE_FirstMoveTable::Build(const NABE_NavGraph& graph, size_t num_threads)
+{
+	Clear();
+
+	const auto num_areas = static_cast<uint32_t>(graph.GetNumAreas());
+	for (uint32_t area = 0; area < num_areas; ++area) {
+		if (graph.GetEdgesEnd(area) - graph.GetEdgesBegin(area) >= NO_MOVE) {
+			return false;
+		}
+	}
+
+	BuildOrdering(graph);
+
+	// Uncompressed table, with a row per source area and a column per target rank.
+	// Each thread fills in the columns of its own targets, from a shortest path tree towards the target.
+	std::vector<uint8_t> moves(static_cast<size_t>(num_areas) * num_areas, NO_MOVE);
+	std::atomic<uint32_t> next_target{ 0 };
+	auto build_columns = [&]() {
+		NABE_NavSearch search;
+		std::vector<uint32_t> next_hops;
+		for (auto target = next_target++; target < num_areas; target = next_target++) {
+			graph.BuildShortestPathTree(target, search, next_hops);
+			const auto column = m_ranks[target];
+			for (uint32_t source = 0; source < num_areas; ++source) {
+				const auto next_hop = next_hops[source];
+				if (next_hop == NABE_NavGraph::INVALID_INDEX) {
+					continue;
+				}
+				for (auto edge = graph.GetEdgesBegin(source); edge != graph.GetEdgesEnd(source); ++edge) {
+					if (graph.GetEdgeTarget(edge) == next_hop) {
+						moves[static_cast<size_t>(source) * num_areas + column] = static_cast<uint8_t>(edge - graph.GetEdgesBegin(source));
+						break;
+					}
+				}
+			}
+		}
+	};
+
+	num_threads = std::max<size_t>(1, std::min<size_t>(num_threads, num_areas));
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < num_threads; ++i) {
+		threads.emplace_back(build_columns);
+	}
+	build_columns();
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	// Run-length encode the rows.
+	m_row_offsets.assign(num_areas + 1, 0);
+	for (uint32_t source = 0; source < num_areas; ++source) {
+		m_row_offsets[source] = static_cast<uint32_t>(m_run_starts.size());
+		const auto row = &moves[static_cast<size_t>(source) * num_areas];
+		for (uint32_t rank = 0; rank < num_areas; ++rank) {
+			if (rank == 0 || row[rank] != row[rank - 1]) {
+				m_run_starts.push_back(rank);
+				m_run_moves.push_back(row[rank]);
+			}
+		}
+	}
+	m_row_offsets[num_areas] = static_cast<uint32_t>(m_run_starts.size());
+
+	return true;
+}
+
+uint8_t NABE_FirstMoveTable::GetFirstMove(uint32_t from, uint32_t to) const
+{
+	if (from >= GetNumAreas() || to >= GetNumAreas()) {
+		return NO_MOVE;
+	}
+
+	// The last run starting at or before the target.
+	const auto rank = m_ranks[to];
+	const auto begin = m_run_starts.begin() + m_row_offsets[from];
+	const auto end = m_run_starts.begin() + m_row_offsets[from + 1];
+	const auto run = std::upper_bound(begin, end, rank);
+	if (run == begin) {
+		return NO_MOVE;
+	}
+	return m_run_moves[(run - m_run_starts.begin()) - 1];
+}
+
+bool NABE_FirstMoveTable::GetPath(const NABE_NavGraph& graph, uint32_t from, uint32_t to, std::vector<uint32_t>& out_path) const
+{
+	out_path.clear();
+	if (!IsBuilt() || from >= GetNumAreas() || to >= GetNumAreas()) {
+		return false;
+	}
+
+	for (auto area = from; area != to; ) {
+		const auto move = GetFirstMove(area, to);
+		// Also guards against looping forever, should the table be broken.
+		if (move == NO_MOVE || out_path.size() >= GetNumAreas()) {
+			out_path.clear();
+			return false;
+		}
+		out_path.push_back(area);
+		area = graph.GetEdgeTarget(graph.GetEdgesBegin(area) + move);
+	}
+	out_path.push_back(to);
+	return true;
+}
+
+size_t NABE_FirstMoveTable::GetMemoryUsage() const
+{
+	return m_ranks.size() * sizeof(m_ranks[0]) +
+		m_row_offsets.size() * sizeof(m_row_offsets[0]) +
+		m_run_starts.size() * sizeof(m_run_starts[0]) +
+		m_run_moves.size() * sizeof(m_run_moves[0]);
+}
+
+bool NABE_FirstMoveTable::Save(const fs::path& path, const NABE_NavGraph& graph) const
+{
+	if (!IsBuilt()) {
+		return false;
+	}
+
+	std::ofstream file(path.string(), std::ios::binary | std::ios::trunc);
+	if (!file) {
+		return false;
+	}
+
+	FirstMoveTableFileHeader header;
+	header.magic = first_move_table_magic;
+	header.version = first_move_table_version;
+	header.graph_hash = graph.GetHash();
+	header.num_areas = static_cast<uint32_t>(GetNumAreas());
+	header.num_runs = static_cast<uint32_t>(GetNumRuns());
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(m_ranks.data()), m_ranks.size() * sizeof(m_ranks[0]));
+	file.write(reinterpret_cast<const char*>(m_row_offsets.data()), m_row_offsets.size() * sizeof(m_row_offsets[0]));
+	file.write(reinterpret_cast<const char*>(m_run_starts.data()), m_run_starts.size() * sizeof(m_run_starts[0]));
+	file.write(reinterpret_cast<const char*>(m_run_moves.data()), m_run_moves.size() * sizeof(m_run_moves[0]));
+	return file.good();
+}
+
+bool NABE_FirstMoveTable::Load(const fs::path& path, const NABE_NavGraph& graph)
+{
+	Clear();
+
+	std::ifstream file(path.string(), std::ios::binary);
+	if (!file) {
+		return false;
+	}
+
+	FirstMoveTableFileHeader header;
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+		header.magic != first_move_table_magic ||
+		header.version != first_move_table_version ||
+		header.graph_hash != graph.GetHash() ||
+		header.num_areas != graph.GetNumAreas() ||
+		static_cast<uint64_t>(header.num_runs) > static_cast<uint64_t>(header.num_areas) * header.num_areas)
+	{
+		return false;
+	}
+
+	m_ranks.resize(header.num_areas);
+	m_row_offsets.resize(static_cast<size_t>(header.num_areas) + 1);
+	m_run_starts.resize(header.num_runs);
+	m_run_moves.resize(header.num_runs);
+
+	file.read(reinterpret_cast<char*>(m_ranks.data()), m_ranks.size() * sizeof(m_ranks[0]));
+	file.read(reinterpret_cast<char*>(m_row_offsets.data()), m_row_offsets.size() * sizeof(m_row_offsets[0]));
+	file.read(reinterpret_cast<char*>(m_run_starts.data()), m_run_starts.size() * sizeof(m_run_starts[0]));
+	file.read(reinterpret_cast<char*>(m_run_moves.data()), m_run_moves.size() * sizeof(m_run_moves[0]));
+	if (!file || !IsValid(graph)) {
+		Clear();
+		return false;
+	}
+	return true;
+}
+
+bool NABE_FirstMoveTable::IsValid(const NABE_NavGraph& graph) const
+{
+	const auto num_areas = static_cast<uint32_t>(GetNumAreas());
+	if (num_areas != graph.GetNumAreas() || m_row_offsets.size() != static_cast<size_t>(num_areas) + 1 ||
+		m_row_offsets.front() != 0 || m_row_offsets.back() != GetNumRuns() || m_run_moves.size() != GetNumRuns())
+	{
+		return false;
+	}
+
+	for (auto rank : m_ranks) {
+		if (rank >= num_areas) {
+			return false;
+		}
+	}
+
+	// Every row must cover its own runs, with increasing target ranks, and moves along the area's own connections.
+	for (uint32_t area = 0; area < num_areas; ++area) {
+		const auto begin = m_row_offsets[area];
+		const auto end = m_row_offsets[area + 1];
+		if (end < begin || end > GetNumRuns()) {
+			return false;
+		}
+		const auto num_edges = graph.GetEdgesEnd(area) - graph.GetEdgesBegin(area);
+		for (auto run = begin; run != end; ++run) {
+			if (m_run_starts[run] >= num_areas || (run != begin && m_run_starts[run] <= m_run_starts[run - 1]) ||
+				(m_run_moves[run] != NO_MOVE && m_run_moves[run] >= num_edges))
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
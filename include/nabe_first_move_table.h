@@ -0,0 +1,59 @@
+#ifndef NABENABE_FIRST_MOVE_TABLE_H
+#define NABENABE_FIRST_MOVE_TABLE_H
+
+#include "nabe_filesystem.h"
+#include "nabe_nav_graph.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Purpose: All-pairs shortest paths of a map, stored as the first move to take from every area towards every other area.
+// A path is then answered by a chain of lookups, without any searching.
+//
+// Each source area's row of first moves is run-length encoded, over the target areas in depth first order,
+// so that areas close to each other (which mostly share the same first move) are next to each other.
+// Moves are stored as the index of the connection among the source area's connections.
+// Only worth it for smaller maps: building costs a full search per area, and the memory grows with the square
+// of the number of areas in the worst case.
+class NABE_FirstMoveTable
+{
+public:
+	static constexpr uint8_t NO_MOVE = 0xFF;
+
+	// Build the table for the graph, with its current blocked areas, spread over num_threads threads.
+	// Fails if some area has too many connections for the move encoding.
+	bool Build(const NABE_NavGraph& graph, size_t num_threads);
+
+	// The table file is tied to the graph it was built from, and fails to load for any other.
+	bool Save(const fs::path& path, const NABE_NavGraph& graph) const;
+	bool Load(const fs::path& path, const NABE_NavGraph& graph);
+
+	bool IsBuilt() const { return !m_row_offsets.empty(); }
+	void Clear();
+
+	uint8_t GetFirstMove(uint32_t from, uint32_t to) const;
+	bool GetPath(const NABE_NavGraph& graph, uint32_t from, uint32_t to, std::vector<uint32_t>& out_path) const;
+
+	size_t GetNumAreas() const { return m_ranks.size(); }
+	size_t GetNumRuns() const { return m_run_starts.size(); }
+	size_t GetMemoryUsage() const;
+
+private:
+	// Order of the areas as targets, in depth first order of the graph.
+	void BuildOrdering(const NABE_NavGraph& graph);
+
+	// Whether the table is consistent with the graph, so that following it never leaves the graph's arrays.
+	// For tables loaded from a file, which may be truncated, or stale with the same hash.
+	bool IsValid(const NABE_NavGraph& graph) const;
+
+	// Position of each area in the target ordering.
+	std::vector<uint32_t> m_ranks;
+	// Runs of each source area are [m_row_offsets[area], m_row_offsets[area + 1]).
+	std::vector<uint32_t> m_row_offsets;
+	// First target rank, and the move towards all of the targets, of each run.
+	std::vector<uint32_t> m_run_starts;
+	std::vector<uint8_t> m_run_moves;
+};
+
+#endif // NABENABE_FIRST_MOVE_TABLE_H
@@ -0,0 +1,52 @@
+#include "nabe_goal_tree_cache.h"
+
+bool NABE_GoalTreeCache::GetPath(const NABE_NavGraph& graph, uint32_t from, uint32_t goal, std::vector<uint32_t>& out_path)
+{
+	out_path.clear();
+	if (m_capacity == 0) {
+		return false;
+	}
+
+	auto it = m_lookup.find(goal);
+	if (it == m_lookup.end()) {
+		if (++m_num_requests[goal] < m_min_requests) {
+			return false;
+		}
+		m_num_requests.erase(goal);
+
+		// Evict the least recently used tree to make room.
+		if (m_trees.size() >= m_capacity) {
+			m_lookup.erase(m_trees.back().goal);
+			m_trees.pop_back();
+		}
+
+		m_trees.emplace_front();
+		m_trees.front().goal = goal;
+		graph.BuildShortestPathTree(goal, m_search, m_trees.front().next_hops, &m_trees.front().costs);
+		it = m_lookup.emplace(goal, m_trees.begin()).first;
+		++m_num_builds;
+	}
+	else {
+		// Move to front, since this is now the most recently used tree.
+		m_trees.splice(m_trees.begin(), m_trees, it->second);
+		++m_num_hits;
+	}
+
+	graph.WalkShortestPathTree(it->second->next_hops, from, goal, out_path);
+	return true;
+}
+
+void NABE_GoalTreeCache::Repair(const NABE_NavGraph& graph, const std::vector<uint32_t>& changed_areas)
+{
+	for (auto& tree : m_trees) {
+		graph.RepairShortestPathTree(tree.goal, changed_areas, m_search, tree.next_hops, tree.costs);
+		++m_num_repairs;
+	}
+}
+
+void NABE_GoalTreeCache::Clear()
+{
+	m_trees.clear();
+	m_lookup.clear();
+	m_num_requests.clear();
+}
@@ -0,0 +1,64 @@
+#ifndef NABENABE_GOAL_TREE_CACHE_H
+#define NABENABE_GOAL_TREE_CACHE_H
+
+#include "nabe_nav_graph.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Purpose: Shortest path trees of a map's most requested goal areas.
+// Once a goal has been requested often enough, a single backwards search from it finds the next hop
+// towards it from every area of the map, and any later path to that goal is answered by following the hops,
+// without searching. Least recently used trees are evicted first. A capacity of 0 disables the cache.
+class NABE_GoalTreeCache
+{
+public:
+	NABE_GoalTreeCache(size_t capacity = 0, size_t min_requests = 1)
+		: m_capacity(capacity), m_min_requests(min_requests)
+	{
+	}
+
+	// Count a request for a path to the goal, building its tree if it has become popular enough.
+	// Returns true if the goal has a tree, in which case out_path receives the path, or is left empty if there is none.
+	bool GetPath(const NABE_NavGraph& graph, uint32_t from, uint32_t goal, std::vector<uint32_t>& out_path);
+
+	// Update every tree after the blocked state of the given areas has changed.
+	void Repair(const NABE_NavGraph& graph, const std::vector<uint32_t>& changed_areas);
+
+	// Forget all trees.
+	void Clear();
+
+	size_t GetCapacity() const { return m_capacity; }
+	size_t GetSize() const { return m_trees.size(); }
+	size_t GetNumHits() const { return m_num_hits; }
+	size_t GetNumBuilds() const { return m_num_builds; }
+	size_t GetNumRepairs() const { return m_num_repairs; }
+
+private:
+	struct Tree {
+		uint32_t goal;
+		std::vector<uint32_t> next_hops;
+		// Cost of each area's path to the goal, for repairing the tree.
+		std::vector<float> costs;
+	};
+
+	// Most recently used trees are kept at the front.
+	std::list<Tree> m_trees;
+	std::unordered_map<uint32_t, std::list<Tree>::iterator> m_lookup;
+	// Requests to goals that don't have a tree (yet).
+	std::unordered_map<uint32_t, size_t> m_num_requests;
+
+	NABE_NavSearch m_search;
+
+	size_t m_capacity;
+	size_t m_min_requests;
+	size_t m_num_hits = 0;
+	size_t m_num_builds = 0;
+	size_t m_num_repairs = 0;
+};
+
+#endif // NABENABE_GOAL_TREE_CACHE_H
@@ -0,0 +1,44 @@
+#include "nabe_ipc_jobs.h"
+
+NABE_Job NABE_IpcRequestToJob(const NABE_IpcRequest& request, long long id)
+{
+	NABE_Job job;
+	job.map_name = request.map_name;
+	job.pos_from = Vector(request.header.pos_from[0], request.header.pos_from[1], request.header.pos_from[2]);
+	job.pos_to = Vector(request.header.pos_to[0], request.header.pos_to[1], request.header.pos_to[2]);
+	job.id = id;
+	return job;
+}
+
+NABE_IpcStatus NABE_IpcGetStatus(NABE_JobStatus status)
+{
+	switch (status) {
+	case NABE_JobStatus::Solved:
+	case NABE_JobStatus::AlreadySolved:
+		return NABE_IPC_STATUS_OK;
+	case NABE_JobStatus::NoArea:
+		return NABE_IPC_STATUS_NO_AREA;
+	case NABE_JobStatus::UnknownMap:
+		return NABE_IPC_STATUS_UNKNOWN_MAP;
+	case NABE_JobStatus::Partial:
+		return NABE_IPC_STATUS_PARTIAL_PATH;
+	case NABE_JobStatus::NoPath:
+	default:
+		return NABE_IPC_STATUS_NO_PATH;
+	}
+}
+
+void NABE_IpcGetWaypoints(const NABE_JobResult& result, std::vector<float>& out_waypoints)
+{
+	out_waypoints.clear();
+	if (!result.HasPath()) {
+		return;
+	}
+
+	out_waypoints.reserve(result.waypoints.size() * 3);
+	for (auto& p : result.waypoints) {
+		out_waypoints.push_back(p.x);
+		out_waypoints.push_back(p.y);
+		out_waypoints.push_back(p.z);
+	}
+}
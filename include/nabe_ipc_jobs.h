@@ -0,0 +1,18 @@
+#ifndef NABENABE_IPC_JOBS_H
+#define NABENABE_IPC_JOBS_H
+
+#include "nabe_ipc_protocol.h"
+#include "nabe_job_source.h"
+
+#include <vector>
+
+// Conversions between the local transport messages and the jobs solved by NABE_JobDispatcher.
+
+NABE_Job NABE_IpcRequestToJob(const NABE_IpcRequest& request, long long id);
+
+NABE_IpcStatus NABE_IpcGetStatus(NABE_JobStatus status);
+
+// out_waypoints receives 3 floats (XYZ) per waypoint of the result's path.
+void NABE_IpcGetWaypoints(const NABE_JobResult& result, std::vector<float>& out_waypoints);
+
+#endif // NABENABE_IPC_JOBS_H
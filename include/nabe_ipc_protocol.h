@@ -0,0 +1,150 @@
+#ifndef NABENABE_IPC_PROTOCOL_H
+#define NABENABE_IPC_PROTOCOL_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Binary protocol for requesting paths from nabe over a local transport, instead of the database.
+//
+// Every message is prefixed by its payload size as an uint32_t, not including the prefix itself.
+// Request payload:  NABE_IpcRequestHeader, followed by map_name_length bytes of the map name (no terminator).
+// Response payload: NABE_IpcResponseHeader, followed by num_waypoints * 3 floats of world XYZ coordinates.
+//
+// Both ends are always on the same machine, so all values are in host byte order.
+
+constexpr uint32_t NABE_IPC_PROTOCOL_VERSION = 1;
+
+// Larger messages are a protocol error, and the connection is dropped.
+constexpr uint32_t NABE_IPC_MAX_MESSAGE_SIZE = 64 * 1024;
+constexpr uint16_t NABE_IPC_MAX_MAP_NAME_LENGTH = 128;
+
+// Request flags. No flags are defined yet, and unknown flags are ignored.
+constexpr uint32_t NABE_IPC_FLAG_NONE = 0;
+
+enum NABE_IpcStatus : uint32_t {
+	NABE_IPC_STATUS_OK = 0,
+	NABE_IPC_STATUS_NO_PATH,		// Both positions are on the map, but there's no route between them.
+	NABE_IPC_STATUS_NO_AREA,		// A position isn't on the nav mesh.
+	NABE_IPC_STATUS_UNKNOWN_MAP,	// We aren't solving for this map.
+	NABE_IPC_STATUS_BAD_REQUEST,
+	NABE_IPC_STATUS_PARTIAL_PATH,	// No full route was found in time, or at all. The waypoints lead towards the goal.
+};
+
+#pragma pack(push, 1)
+struct NABE_IpcRequestHeader {
+	uint32_t request_id;	// Echoed back in the response, so clients can pipeline requests.
+	uint32_t flags;
+	float pos_from[3];
+	float pos_to[3];
+	uint16_t map_name_length;
+};
+
+struct NABE_IpcResponseHeader {
+	uint32_t request_id;
+	uint32_t status;
+	uint32_t num_waypoints;
+};
+#pragma pack(pop)
+
+// Purpose: A request, decoded from its wire format.
+struct NABE_IpcRequest {
+	NABE_IpcRequestHeader header;
+	std::string map_name;
+};
+
+inline uint32_t NABE_IpcRequestPayloadSize(const std::string& map_name)
+{
+	return static_cast<uint32_t>(sizeof(NABE_IpcRequestHeader) + map_name.size());
+}
+
+// Write a request payload (without the size prefix) of NABE_IpcRequestPayloadSize bytes.
+inline void NABE_IpcWriteRequest(uint8_t* payload, const NABE_IpcRequestHeader& header, const std::string& map_name)
+{
+	auto h = header;
+	h.map_name_length = static_cast<uint16_t>(map_name.size());
+	memcpy(payload, &h, sizeof(h));
+	memcpy(payload + sizeof(h), map_name.data(), map_name.size());
+}
+
+// Append a request message, including the size prefix, to out_buffer.
+inline void NABE_IpcEncodeRequest(const NABE_IpcRequestHeader& header, const std::string& map_name,
+	std::vector<uint8_t>& out_buffer)
+{
+	const uint32_t payload_size = NABE_IpcRequestPayloadSize(map_name);
+	const auto offset = out_buffer.size();
+	out_buffer.resize(offset + sizeof(payload_size) + payload_size);
+	memcpy(out_buffer.data() + offset, &payload_size, sizeof(payload_size));
+	NABE_IpcWriteRequest(out_buffer.data() + offset + sizeof(payload_size), header, map_name);
+}
+
+// Decode a request payload (without the size prefix). Returns false if the payload is malformed.
+inline bool NABE_IpcDecodeRequest(const uint8_t* payload, uint32_t payload_size, NABE_IpcRequest& out_request)
+{
+	if (payload_size < sizeof(NABE_IpcRequestHeader)) {
+		return false;
+	}
+	memcpy(&out_request.header, payload, sizeof(NABE_IpcRequestHeader));
+
+	const auto map_name_length = out_request.header.map_name_length;
+	if (map_name_length == 0 || map_name_length > NABE_IPC_MAX_MAP_NAME_LENGTH ||
+		payload_size != sizeof(NABE_IpcRequestHeader) + map_name_length)
+	{
+		return false;
+	}
+	out_request.map_name.assign(reinterpret_cast<const char*>(payload + sizeof(NABE_IpcRequestHeader)), map_name_length);
+	return true;
+}
+
+inline uint32_t NABE_IpcResponsePayloadSize(const std::vector<float>& waypoints)
+{
+	return static_cast<uint32_t>(sizeof(NABE_IpcResponseHeader) + (waypoints.size() / 3) * 3 * sizeof(float));
+}
+
+// Write a response payload (without the size prefix) of NABE_IpcResponsePayloadSize bytes.
+// waypoints holds 3 floats (XYZ) per waypoint.
+inline void NABE_IpcWriteResponse(uint8_t* payload, uint32_t request_id, NABE_IpcStatus status, const std::vector<float>& waypoints)
+{
+	NABE_IpcResponseHeader h;
+	h.request_id = request_id;
+	h.status = status;
+	h.num_waypoints = static_cast<uint32_t>(waypoints.size() / 3);
+	memcpy(payload, &h, sizeof(h));
+	if (h.num_waypoints != 0) {
+		memcpy(payload + sizeof(h), waypoints.data(), h.num_waypoints * 3 * sizeof(float));
+	}
+}
+
+// Append a response message, including the size prefix, to out_buffer.
+inline void NABE_IpcEncodeResponse(uint32_t request_id, NABE_IpcStatus status, const std::vector<float>& waypoints,
+	std::vector<uint8_t>& out_buffer)
+{
+	const uint32_t payload_size = NABE_IpcResponsePayloadSize(waypoints);
+	const auto offset = out_buffer.size();
+	out_buffer.resize(offset + sizeof(payload_size) + payload_size);
+	memcpy(out_buffer.data() + offset, &payload_size, sizeof(payload_size));
+	NABE_IpcWriteResponse(out_buffer.data() + offset + sizeof(payload_size), request_id, status, waypoints);
+}
+
+// Decode a response payload (without the size prefix). Returns false if the payload is malformed.
+inline bool NABE_IpcDecodeResponse(const uint8_t* payload, uint32_t payload_size,
+	NABE_IpcResponseHeader& out_header, std::vector<float>& out_waypoints)
+{
+	if (payload_size < sizeof(NABE_IpcResponseHeader)) {
+		return false;
+	}
+	memcpy(&out_header, payload, sizeof(NABE_IpcResponseHeader));
+
+	const size_t num_floats = static_cast<size_t>(out_header.num_waypoints) * 3;
+	if (payload_size != sizeof(NABE_IpcResponseHeader) + num_floats * sizeof(float)) {
+		return false;
+	}
+	out_waypoints.resize(num_floats);
+	if (num_floats != 0) {
+		memcpy(out_waypoints.data(), payload + sizeof(NABE_IpcResponseHeader), num_floats * sizeof(float));
+	}
+	return true;
+}
+
+#endif // NABENABE_IPC_PROTOCOL_H
@@ -0,0 +1,207 @@
+#include "nabe_job_dispatcher.h"
+
+#include "nabe_pathfinder.h"
+#include "print_helpers.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <thread>
+#include <tuple>
+
+size_t NABE_JobDispatcher::Dispatch(NABE_JobSource& source, NABE_ResultSink& sink)
+{
+	m_jobs.clear();
+	source.FetchJobs(m_jobs);
+	if (m_jobs.empty()) {
+		return 0;
+	}
+
+	struct JobGroup {
+		std::vector<const NABE_Job*> jobs;
+		NABE_JobResult result;
+	};
+	// Keyed by map name, from area id, to area id, and route options.
+	std::map<std::tuple<std::string, int, int, NABE_RouteOptions>, JobGroup> groups;
+	// Jobs that don't need solving, or can't be solved.
+	std::vector<std::pair<const NABE_Job*, NABE_JobResult>> unsolved_jobs;
+
+	for (auto& job : m_jobs) {
+		NABE_JobResult result;
+		if (job.already_solved) {
+			result.status = NABE_JobStatus::AlreadySolved;
+		}
+		else if (!m_pathfinder->HasMap(job.map_name)) {
+			result.status = NABE_JobStatus::UnknownMap;
+		}
+		else if (!m_pathfinder->ResolveAreas(job.map_name, job.pos_from, job.pos_to, result.area_id_from, result.area_id_to)) {
+			print(Error, "%s: Failed to resolve nav areas for \"%s\"", __FUNCTION__, job.map_name.c_str());
+			result.status = NABE_JobStatus::NoArea;
+		}
+		else {
+			auto& group = groups[std::make_tuple(job.map_name, result.area_id_from, result.area_id_to, job.route)];
+			if (group.jobs.empty()) {
+				group.result = result;
+			}
+			group.jobs.push_back(&job);
+			continue;
+		}
+		unsolved_jobs.emplace_back(&job, std::move(result));
+	}
+
+	// Groups that need solving, by map name, from area id, and route options.
+	std::map<std::tuple<std::string, int, NABE_RouteOptions>, std::vector<JobGroup*>> sources;
+	for (auto& group : groups) {
+		if (!Lookup(*group.second.jobs.front(), sink, group.second.result)) {
+			sources[std::make_tuple(std::get<0>(group.first), std::get<1>(group.first), std::get<3>(group.first))].push_back(&group.second);
+		}
+
+		if (m_verbosity && group.second.jobs.size() > 1) {
+			print(Info, "%s: %s: Area %d --> area %d was requested by %zd jobs, solved once.",
+				__FUNCTION__, std::get<0>(group.first).c_str(), std::get<1>(group.first), std::get<2>(group.first),
+				group.second.jobs.size());
+		}
+	}
+
+	for (auto& source : sources) {
+		auto& source_groups = source.second;
+		if (source_groups.size() == 1) {
+			Solve(*source_groups.front()->jobs.front(), source_groups.front()->result);
+			continue;
+		}
+
+		std::vector<int> area_ids_to;
+		for (auto& group : source_groups) {
+			area_ids_to.push_back(group->result.area_id_to);
+		}
+		std::vector<std::list<CNavArea*>> paths;
+		m_pathfinder->SolveMany(std::get<0>(source.first), std::get<1>(source.first), area_ids_to, paths, std::get<2>(source.first), false);
+
+		for (size_t i = 0; i < source_groups.size(); ++i) {
+			auto& result = source_groups[i]->result;
+			if (paths[i].empty()) {
+				// Without a full path, a search of its own may still give a partial one.
+				if (m_pathfinder->GetPartialPaths()) {
+					Solve(*source_groups[i]->jobs.front(), result);
+				}
+				else {
+					result.status = NABE_JobStatus::NoPath;
+				}
+				continue;
+			}
+			result.path = std::move(paths[i]);
+			result.status = NABE_JobStatus::Solved;
+			result.solved_now = true;
+		}
+
+		if (m_verbosity) {
+			print(Info, "%s: %s: %zd routes from area %d shared a search.",
+				__FUNCTION__, std::get<0>(source.first).c_str(), source_groups.size(), std::get<1>(source.first));
+		}
+	}
+
+	size_t num_solved = 0;
+	sink.BeginResults();
+	for (auto& group : groups) {
+		auto& result = group.second.result;
+		for (auto& job : group.second.jobs) {
+			// The areas are shared by the group, but each job smooths them between its own positions.
+			if (result.HasPath()) {
+				m_pathfinder->GetWaypoints(job->map_name, job->pos_from, job->pos_to, result.path,
+					result.status == NABE_JobStatus::Partial, result.waypoints);
+			}
+			sink.WriteResult(*job, result);
+		}
+		if (group.second.result.HasPath()) {
+			num_solved += group.second.jobs.size();
+		}
+	}
+	for (auto& job : unsolved_jobs) {
+		sink.WriteResult(*job.first, job.second);
+	}
+	sink.EndResults();
+
+	return num_solved;
+}
+
+size_t NABE_JobDispatcher::DispatchAll(const std::vector<NABE_JobTransport>& transports)
+{
+	size_t num_solved = 0;
+	for (auto& transport : transports) {
+		num_solved += Dispatch(*transport.source, *transport.sink);
+	}
+	return num_solved;
+}
+
+void NABE_JobDispatcher::Idle(const std::vector<NABE_JobTransport>& transports, int duration_ms)
+{
+	std::vector<NABE_JobTransport> waitable;
+	for (auto& transport : transports) {
+		transport.source->OnIdle();
+		if (transport.source->CanWaitForJobs()) {
+			waitable.push_back(transport);
+		}
+	}
+
+	if (waitable.empty()) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(duration_ms));
+		return;
+	}
+
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(duration_ms);
+	for (;;) {
+		const auto time_left_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+			deadline - std::chrono::steady_clock::now()).count();
+		if (time_left_ms <= 0) {
+			break;
+		}
+
+		// With several sources to wait on, they take turns in short waits so neither is left waiting for the other.
+		const int wait_ms = (waitable.size() == 1) ? static_cast<int>(time_left_ms) : 1;
+		for (auto& transport : waitable) {
+			transport.source->WaitForJobs(wait_ms);
+			Dispatch(*transport.source, *transport.sink);
+		}
+	}
+}
+
+bool NABE_JobDispatcher::Lookup(const NABE_Job& job, NABE_ResultSink& sink, NABE_JobResult& result)
+{
+	const auto area_id_from = result.area_id_from;
+	const auto area_id_to = result.area_id_to;
+
+	result.path.clear();
+	result.solved_now = false;
+	result.status = NABE_JobStatus::Solved;
+
+	// Stored paths are all for the default options.
+	if (job.route.IsDefault()) {
+		if (m_pathfinder->GetCachedPath(job.map_name, area_id_from, area_id_to, result.path)) {
+			return true;
+		}
+
+		if (sink.LookupPath(job, area_id_from, area_id_to, result.path)) {
+			m_pathfinder->CachePath(job.map_name, area_id_from, area_id_to, result.path);
+			return true;
+		}
+	}
+
+	result.path.clear();
+	return false;
+}
+
+void NABE_JobDispatcher::Solve(const NABE_Job& job, NABE_JobResult& result)
+{
+	result.path.clear();
+	result.solved_now = false;
+	bool partial = false;
+	// Lookup already missed the path cache.
+	if (m_pathfinder->Solve(job.map_name, result.area_id_from, result.area_id_to, result.path, &partial, job.route, false)) {
+		result.status = partial ? NABE_JobStatus::Partial : NABE_JobStatus::Solved;
+		result.solved_now = true;
+		return;
+	}
+
+	result.path.clear();
+	result.status = NABE_JobStatus::NoPath;
+}
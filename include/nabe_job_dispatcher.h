@@ -0,0 +1,49 @@
+#ifndef NABENABE_JOB_DISPATCHER_H
+#define NABENABE_JOB_DISPATCHER_H
+
+#include "nabe_job_source.h"
+
+#include <vector>
+
+class NABE_PathFinder;
+
+// Will wait for this long between polls of job sources that can't notify us of new jobs.
+constexpr int NABE_IDLE_SLEEP_MS = 1000;
+
+struct NABE_JobTransport {
+	NABE_JobSource* source;
+	NABE_ResultSink* sink;
+};
+
+// Purpose: Solves jobs from any number of job sources with a single NABE_PathFinder, so that the nav data
+// of each map is only ever loaded once.
+class NABE_JobDispatcher
+{
+public:
+	NABE_JobDispatcher(NABE_PathFinder* pathfinder, bool verbosity) : m_pathfinder(pathfinder), m_verbosity(verbosity)
+	{
+	}
+
+	// Fetch a batch of jobs from the source, solve them, and write the results to the sink.
+	// Jobs resolving to the same pair of nav areas on the same map are solved only once, and jobs leaving
+	// the same area for different ones share a single search (see NABE_PathFinder::SolveMany).
+	// Returns the number of jobs solved.
+	size_t Dispatch(NABE_JobSource& source, NABE_ResultSink& sink);
+	size_t DispatchAll(const std::vector<NABE_JobTransport>& transports);
+
+	// Called when there were no jobs. Keeps serving the transports that can be waited on for duration_ms,
+	// and then returns so that the others can be polled again.
+	void Idle(const std::vector<NABE_JobTransport>& transports, int duration_ms);
+
+private:
+	// Get a path between a job's areas, without solving. Lookup order is: in-memory cache, then paths stored by the sink.
+	bool Lookup(const NABE_Job& job, NABE_ResultSink& sink, NABE_JobResult& result);
+	// Solve a path between a job's areas. Only called after Lookup failed, so it skips the path cache.
+	void Solve(const NABE_Job& job, NABE_JobResult& result);
+
+	NABE_PathFinder* m_pathfinder;
+	std::vector<NABE_Job> m_jobs;
+	bool m_verbosity;
+};
+
+#endif // NABENABE_JOB_DISPATCHER_H
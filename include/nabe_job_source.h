@@ -0,0 +1,84 @@
+#ifndef NABENABE_JOB_SOURCE_H
+#define NABENABE_JOB_SOURCE_H
+
+#include "thirdparty/source-sdk-stubs/nav.h"
+
+#include "nabe_route_options.h"
+
+#include <list>
+#include <string>
+#include <vector>
+
+class CNavArea;
+
+// Purpose: A request for a path, from any source of jobs.
+struct NABE_Job {
+	std::string map_name;
+	Vector pos_from;
+	Vector pos_to;
+	NABE_RouteOptions route;
+	// Identifies the job to the source it came from, eg. a database row.
+	long long id = 0;
+	// Set by sources that know the requester already has a path for this, so the job only needs to be acknowledged.
+	bool already_solved = false;
+};
+
+enum class NABE_JobStatus {
+	Solved = 0,
+	NoPath,			// Both positions are on the map, but there's no route between them.
+	NoArea,			// A position isn't on the nav mesh.
+	UnknownMap,		// We aren't solving for this map.
+	AlreadySolved,	// See NABE_Job::already_solved.
+	Partial,		// No full path was found within the search budget, or at all. The path leads towards the goal,
+					// ending at the area closest to it.
+};
+
+struct NABE_JobResult {
+	NABE_JobStatus status = NABE_JobStatus::NoPath;
+	int area_id_from = AREA_ID_NONE;
+	int area_id_to = AREA_ID_NONE;
+	// Whether the path was solved just now, rather than found in a cache or the sink's stored paths.
+	bool solved_now = false;
+	std::list<CNavArea*> path;
+	// The positions to move through, for the job being written (see NABE_PathFinder::GetWaypoints).
+	std::vector<Vector> waypoints;
+
+	bool HasPath() const { return status == NABE_JobStatus::Solved || status == NABE_JobStatus::Partial; }
+};
+
+// Purpose: Somewhere jobs come from, eg. a SourceMod database or a local socket.
+class NABE_JobSource
+{
+public:
+	virtual ~NABE_JobSource() = default;
+
+	// Collect the next batch of jobs to solve.
+	virtual void FetchJobs(std::vector<NABE_Job>& out_jobs) = 0;
+
+	// Called when a loop didn't solve anything, eg. for maintenance.
+	virtual void OnIdle() {}
+
+	// Sources that can be notified of new jobs can be waited on, instead of polled.
+	virtual bool CanWaitForJobs() const { return false; }
+	virtual void WaitForJobs(int timeout_ms) {}
+};
+
+// Purpose: Somewhere the results of jobs are delivered to. Usually the same object as the job source.
+class NABE_ResultSink
+{
+public:
+	virtual ~NABE_ResultSink() = default;
+
+	// Optionally, answer a job from paths stored by the sink earlier, instead of solving it.
+	virtual bool LookupPath(const NABE_Job& job, int area_id_from, int area_id_to, std::list<CNavArea*>& out_path)
+	{
+		return false;
+	}
+
+	// All of a batch's results are written between these calls.
+	virtual void BeginResults() {}
+	virtual void WriteResult(const NABE_Job& job, const NABE_JobResult& result) = 0;
+	virtual void EndResults() {}
+};
+
+#endif // NABENABE_JOB_SOURCE_H
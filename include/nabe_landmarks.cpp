@@ -0,0 +1,77 @@
+#include "nabe_landmarks.h"
+
+#include <algorithm>
+#include <limits>
+
+bool NABE_Landmarks::Build(const NABE_NavGraph& graph, const NABE_RouteOptions& route, size_t num_landmarks)
+{
+	constexpr auto no_path = std::numeric_limits<float>::infinity();
+
+	m_num_landmarks = 0;
+	m_costs_from.clear();
+	m_costs_to.clear();
+
+	const auto num_areas = graph.GetNumAreas();
+	if (num_areas == 0 || num_landmarks == 0) {
+		return false;
+	}
+
+	NABE_NavSearch search;
+	std::vector<std::vector<float>> costs_from;
+	std::vector<std::vector<float>> costs_to;
+
+	// Cost between each area and its nearest landmark so far, in either direction. The next landmark is the area
+	// farthest from all of the previous ones. The first is the area farthest from the best connected area,
+	// which tends to lie at the edge of the map's main component.
+	auto num_connections = [&graph](uint32_t area) {
+		return (graph.GetEdgesEnd(area) - graph.GetEdgesBegin(area)) + (graph.GetReverseEdgesEnd(area) - graph.GetReverseEdgesBegin(area));
+	};
+	uint32_t best_connected = 0;
+	for (uint32_t area = 1; area < num_areas; ++area) {
+		if (num_connections(area) > num_connections(best_connected)) {
+			best_connected = area;
+		}
+	}
+	std::vector<float> nearest;
+	graph.ComputeCosts(best_connected, false, route, search, nearest);
+
+	auto farthest = [num_areas, &nearest]() {
+		uint32_t farthest_area = NABE_NavGraph::INVALID_INDEX;
+		float farthest_cost = 0;
+		for (uint32_t area = 0; area < num_areas; ++area) {
+			if (nearest[area] != no_path && nearest[area] > farthest_cost) {
+				farthest_cost = nearest[area];
+				farthest_area = area;
+			}
+		}
+		return farthest_area;
+	};
+
+	auto landmark = farthest();
+	nearest.assign(num_areas, no_path);
+	for (; landmark != NABE_NavGraph::INVALID_INDEX && costs_from.size() < num_landmarks; landmark = farthest()) {
+		costs_from.emplace_back();
+		costs_to.emplace_back();
+		graph.ComputeCosts(landmark, false, route, search, costs_from.back());
+		graph.ComputeCosts(landmark, true, route, search, costs_to.back());
+
+		for (uint32_t area = 0; area < num_areas; ++area) {
+			nearest[area] = std::min({ nearest[area], costs_from.back()[area], costs_to.back()[area] });
+		}
+	}
+
+	if (costs_from.empty()) {
+		return false;
+	}
+
+	m_num_landmarks = costs_from.size();
+	m_costs_from.resize(num_areas * m_num_landmarks);
+	m_costs_to.resize(num_areas * m_num_landmarks);
+	for (size_t i = 0; i < m_num_landmarks; ++i) {
+		for (size_t area = 0; area < num_areas; ++area) {
+			m_costs_from[area * m_num_landmarks + i] = costs_from[i][area];
+			m_costs_to[area * m_num_landmarks + i] = costs_to[i][area];
+		}
+	}
+	return true;
+}
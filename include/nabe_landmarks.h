@@ -0,0 +1,61 @@
+#ifndef NABENABE_LANDMARKS_H
+#define NABENABE_LANDMARKS_H
+
+#include "nabe_nav_graph.h"
+#include "nabe_route_options.h"
+
+#include <cstdint>
+#include <vector>
+
+// Purpose: Precomputed costs to and from a few landmark areas, for a tighter A* heuristic than the straight
+// line distance (the ALT technique: A*, landmarks and the triangle inequality). Built for one set of route options,
+// and only valid for searches with those same options.
+//
+// The costs are computed as if no area was blocked, so blocking areas later can only make them underestimate,
+// which is still a valid heuristic; the landmarks never need rebuilding for blocked areas.
+class NABE_Landmarks
+{
+public:
+	// Pick up to num_landmarks areas spread far apart from each other, and compute the costs between them and every area.
+	// Returns false if there was nothing to build.
+	bool Build(const NABE_NavGraph& graph, const NABE_RouteOptions& route, size_t num_landmarks);
+
+	bool IsBuilt() const { return m_num_landmarks != 0; }
+	size_t GetNumLandmarks() const { return m_num_landmarks; }
+	size_t GetMemoryUsage() const { return (m_costs_from.size() + m_costs_to.size()) * sizeof(float); }
+
+	// Never overestimates the cost of the path from one area to another, with the route options of the landmarks.
+	// Infinity if there certainly is no path.
+	float GetLowerBound(uint32_t from, uint32_t to) const
+	{
+		const float* landmark_to_from = &m_costs_from[from * m_num_landmarks];
+		const float* landmark_to_to = &m_costs_from[to * m_num_landmarks];
+		const float* from_to_landmark = &m_costs_to[from * m_num_landmarks];
+		const float* to_to_landmark = &m_costs_to[to * m_num_landmarks];
+
+		// By the triangle inequality, for any landmark L:
+		// cost(L, to) <= cost(L, from) + cost(from, to), and cost(from, L) <= cost(from, to) + cost(to, L).
+		// Differences of two infinities are NaN, and never pass the comparisons.
+		float bound = 0;
+		for (size_t i = 0; i < m_num_landmarks; ++i) {
+			const float before = landmark_to_to[i] - landmark_to_from[i];
+			if (before > bound) {
+				bound = before;
+			}
+			const float after = from_to_landmark[i] - to_to_landmark[i];
+			if (after > bound) {
+				bound = after;
+			}
+		}
+		return bound;
+	}
+
+private:
+	size_t m_num_landmarks = 0;
+	// Costs from each landmark to each area, and from each area to each landmark, indexed by [area * m_num_landmarks + landmark],
+	// so that a single lookup reads all of an area's costs at once.
+	std::vector<float> m_costs_from;
+	std::vector<float> m_costs_to;
+};
+
+#endif // NABENABE_LANDMARKS_H
@@ -0,0 +1,95 @@
+#include "nabe_map_lock.h"
+
+#include "nabe_filesystem.h"
+#include "print_helpers.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else // Linux
+#include <fcntl.h> // For O_* constants
+#include <sys/file.h> // flock
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+#include <cstdint>
+#include <cstdio>
+
+NABE_MapLock::NABE_MapLock(const std::string& db_location, const std::string& map_name)
+{
+	// The database path can be arbitrarily long and contain characters that are not allowed in lock names,
+	// so identify it by its FNV-1a hash instead.
+	uint64_t db_hash = 14695981039346656037ULL;
+	for (const auto& c : db_location) {
+		db_hash ^= static_cast<unsigned char>(c);
+		db_hash *= 1099511628211ULL;
+	}
+
+	constexpr size_t hash_max_size = 17;
+	char hash[hash_max_size]{ 0 };
+	snprintf(hash, hash_max_size, "%016llx", static_cast<unsigned long long>(db_hash));
+
+#ifdef _WIN32
+	m_name = "Local\\nabe_" + map_name + "_" + hash;
+#else
+	m_name = (fs::temp_directory_path() / ("nabe_" + map_name + "_" + hash + ".lock")).string();
+#endif
+}
+
+NABE_MapLock::~NABE_MapLock()
+{
+#ifdef _WIN32
+	if (m_handle) {
+		CloseHandle(static_cast<HANDLE>(m_handle));
+	}
+#else
+	// Closing releases the lock. The file isn't unlinked, since another process may be about to lock it.
+	if (m_fd != -1 && close(m_fd) != 0) {
+		print(Error, "%s: Failed to close lock file \"%s\" (errno %d)", __FUNCTION__, m_name.c_str(), errno);
+	}
+#endif
+}
+
+NABE_MapLock::Result NABE_MapLock::TryLock()
+{
+#ifdef _WIN32
+	if (m_handle) {
+		return Result::Acquired;
+	}
+
+	auto handle = CreateMutexA(0, FALSE, m_name.c_str());
+	const auto error = GetLastError();
+	if (!handle) {
+		print(Error, "%s: Unexpected error occurred whilst creating mutex \"%s\" (error %lu)",
+			__FUNCTION__, m_name.c_str(), error);
+		return Result::Failed;
+	}
+	if (error == ERROR_ALREADY_EXISTS) {
+		CloseHandle(handle);
+		return Result::HeldByOther;
+	}
+	m_handle = handle;
+#else
+	if (m_fd != -1) {
+		return Result::Acquired;
+	}
+
+	const auto fd = open(m_name.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+	if (fd == -1) {
+		print(Error, "%s: Lock file \"%s\" open failed (errno %d)", __FUNCTION__, m_name.c_str(), errno);
+		return Result::Failed;
+	}
+	if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+		const auto error = errno;
+		close(fd);
+		if (error == EWOULDBLOCK) {
+			return Result::HeldByOther;
+		}
+		print(Error, "%s: Lock file \"%s\" lock failed (errno %d)", __FUNCTION__, m_name.c_str(), error);
+		return Result::Failed;
+	}
+	m_fd = fd;
+#endif
+
+	return Result::Acquired;
+}
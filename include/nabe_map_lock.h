@@ -0,0 +1,36 @@
+#ifndef NABENABE_MAP_LOCK_H
+#define NABENABE_MAP_LOCK_H
+
+#include <string>
+
+// Purpose: System wide named lock for solving the jobs of one map in one database.
+// Several nabe processes can share a database, but only one of them will hold the lock for any given map,
+// so the nav data of each map is only loaded by a single process.
+// The lock is released by the system when its process exits, even if it crashed: a named mutex on Windows,
+// and a flock of a lock file in the temp directory on Linux (the file itself is left behind, and reused).
+class NABE_MapLock
+{
+public:
+	NABE_MapLock(const std::string& db_location, const std::string& map_name);
+	~NABE_MapLock();
+
+	enum class Result {
+		Acquired = 0,
+		HeldByOther,
+		Failed
+	};
+
+	Result TryLock();
+
+	const std::string& GetName() const { return m_name; }
+
+private:
+	std::string m_name;
+#ifdef _WIN32
+	void* m_handle = nullptr;
+#else
+	int m_fd = -1;
+#endif
+};
+
+#endif // NABENABE_MAP_LOCK_H
@@ -0,0 +1,42 @@
+#include "nabe_memory_job_queue.h"
+
+long long NABE_MemoryJobQueue::AddJob(const std::string& map_name, const Vector& pos_from, const Vector& pos_to)
+{
+	NABE_Job job;
+	job.map_name = map_name;
+	job.pos_from = pos_from;
+	job.pos_to = pos_to;
+	job.id = m_next_id++;
+	m_pending.push_back(std::move(job));
+	return m_pending.back().id;
+}
+
+bool NABE_MemoryJobQueue::TakeResult(long long id, NABE_JobStatus& out_status, std::vector<Vector>& out_waypoints)
+{
+	auto it = m_results.find(id);
+	if (it == m_results.end()) {
+		return false;
+	}
+	out_status = it->second.status;
+	out_waypoints = std::move(it->second.waypoints);
+	m_results.erase(it);
+	return true;
+}
+
+void NABE_MemoryJobQueue::FetchJobs(std::vector<NABE_Job>& out_jobs)
+{
+	while (!m_pending.empty() && (m_batch_size == 0 || out_jobs.size() < m_batch_size)) {
+		out_jobs.push_back(std::move(m_pending.front()));
+		m_pending.pop_front();
+	}
+}
+
+void NABE_MemoryJobQueue::WriteResult(const NABE_Job& job, const NABE_JobResult& result)
+{
+	auto& stored = m_results[job.id];
+	stored.status = result.status;
+	stored.waypoints.clear();
+	if (result.HasPath()) {
+		stored.waypoints = result.waypoints;
+	}
+}
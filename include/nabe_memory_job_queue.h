@@ -0,0 +1,50 @@
+#ifndef NABENABE_MEMORY_JOB_QUEUE_H
+#define NABENABE_MEMORY_JOB_QUEUE_H
+
+#include "nabe_job_source.h"
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+// Purpose: Job source and result sink that lives entirely in memory.
+// Useful for driving NABE_JobDispatcher without a database, eg. when benchmarking the solver,
+// or when embedding nabe in another process.
+class NABE_MemoryJobQueue : public NABE_JobSource, public NABE_ResultSink
+{
+public:
+	// At most batch_size jobs are handed out per fetch. 0 for no limit.
+	explicit NABE_MemoryJobQueue(size_t batch_size = 0) : m_batch_size(batch_size)
+	{
+	}
+
+	// Returns the id of the new job, for looking up its result.
+	long long AddJob(const std::string& map_name, const Vector& pos_from, const Vector& pos_to);
+
+	// Get the result of a completed job, and forget it. Returns false if the job isn't completed (yet).
+	// out_waypoints receives the positions the path passes through, if it was solved.
+	bool TakeResult(long long id, NABE_JobStatus& out_status, std::vector<Vector>& out_waypoints);
+
+	size_t GetNumPending() const { return m_pending.size(); }
+	size_t GetNumCompleted() const { return m_results.size(); }
+
+	// NABE_JobSource
+	void FetchJobs(std::vector<NABE_Job>& out_jobs) override;
+
+	// NABE_ResultSink
+	void WriteResult(const NABE_Job& job, const NABE_JobResult& result) override;
+
+private:
+	struct Result {
+		NABE_JobStatus status;
+		std::vector<Vector> waypoints;
+	};
+
+	std::deque<NABE_Job> m_pending;
+	std::map<long long, Result> m_results;
+	long long m_next_id = 0;
+	size_t m_batch_size;
+};
+
+#endif // NABENABE_MEMORY_JOB_QUEUE_H
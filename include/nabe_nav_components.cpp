@@ -0,0 +1,158 @@
+#include "nabe_nav_components.h"
+
+#include <algorithm>
+
+void NABE_NavComponents::Build(const NABE_NavGraph& graph)
+{
+	const auto num_areas = graph.GetNumAreas();
+	m_weak.assign(num_areas, INVALID_COMPONENT);
+	m_strong.assign(num_areas, INVALID_COMPONENT);
+	m_order.assign(num_areas, INVALID_COMPONENT);
+	m_lowlinks.assign(num_areas, 0);
+	m_on_stack.assign(num_areas, 0);
+	m_next_weak = 0;
+	m_num_weak = 0;
+
+	for (uint32_t area = 0; area < num_areas; ++area) {
+		if (m_weak[area] == INVALID_COMPONENT && !graph.IsBlocked(area)) {
+			BuildComponent(graph, area);
+			++m_num_weak;
+		}
+	}
+}
+
+void NABE_NavComponents::Update(const NABE_NavGraph& graph, const std::vector<uint32_t>& changed_areas)
+{
+	if (!IsBuilt() || m_next_weak > INVALID_COMPONENT - graph.GetNumAreas()) {
+		Build(graph);
+		return;
+	}
+
+	// Blocking an area can only split up its own weak component, and the pieces all contain some of its neighbours.
+	// Unblocking an area can only join it with its neighbours' weak components.
+	// So flood filling from the changed areas and their neighbours covers every component that may have changed.
+	std::vector<uint32_t> seeds;
+	std::vector<uint32_t> old_components;
+	for (auto area : changed_areas) {
+		seeds.push_back(area);
+		for (auto edge = graph.GetEdgesBegin(area); edge != graph.GetEdgesEnd(area); ++edge) {
+			seeds.push_back(graph.GetEdgeTarget(edge));
+		}
+		for (auto edge = graph.GetReverseEdgesBegin(area); edge != graph.GetReverseEdgesEnd(area); ++edge) {
+			seeds.push_back(graph.GetReverseEdgeSource(edge));
+		}
+	}
+	for (auto area : seeds) {
+		if (m_weak[area] != INVALID_COMPONENT) {
+			old_components.push_back(m_weak[area]);
+		}
+	}
+	std::sort(old_components.begin(), old_components.end());
+	old_components.erase(std::unique(old_components.begin(), old_components.end()), old_components.end());
+
+	for (auto area : changed_areas) {
+		if (graph.IsBlocked(area)) {
+			m_weak[area] = INVALID_COMPONENT;
+			m_strong[area] = INVALID_COMPONENT;
+		}
+	}
+
+	// Components are given new ids as they're rebuilt, so an area still carrying an old id hasn't been reached yet.
+	const auto first_new = m_next_weak;
+	size_t num_new = 0;
+	for (auto area : seeds) {
+		if (!graph.IsBlocked(area) && (m_weak[area] == INVALID_COMPONENT || m_weak[area] < first_new)) {
+			BuildComponent(graph, area);
+			++num_new;
+		}
+	}
+	m_num_weak = m_num_weak + num_new - old_components.size();
+}
+
+size_t NABE_NavComponents::BuildComponent(const NABE_NavGraph& graph, uint32_t root)
+{
+	const auto id = m_next_weak++;
+
+	// Connections are followed both ways.
+	m_region.clear();
+	m_region.push_back(root);
+	m_weak[root] = id;
+	for (size_t i = 0; i < m_region.size(); ++i) {
+		const auto area = m_region[i];
+		auto visit = [&](uint32_t next) {
+			if (m_weak[next] != id && !graph.IsBlocked(next)) {
+				m_weak[next] = id;
+				m_region.push_back(next);
+			}
+		};
+		for (auto edge = graph.GetEdgesBegin(area); edge != graph.GetEdgesEnd(area); ++edge) {
+			visit(graph.GetEdgeTarget(edge));
+		}
+		for (auto edge = graph.GetReverseEdgesBegin(area); edge != graph.GetReverseEdgesEnd(area); ++edge) {
+			visit(graph.GetReverseEdgeSource(edge));
+		}
+	}
+
+	NumberStrongComponents(graph);
+	return m_region.size();
+}
+
+void NABE_NavComponents::NumberStrongComponents(const NABE_NavGraph& graph)
+{
+	for (auto area : m_region) {
+		m_order[area] = INVALID_COMPONENT;
+	}
+
+	// Iterative, since the recursion could get as deep as the number of areas.
+	// Each call frame is (area, next edge to follow).
+	uint32_t next_order = 0;
+	uint32_t next_strong = 0;
+	auto enter = [&](uint32_t area) {
+		m_order[area] = next_order;
+		m_lowlinks[area] = next_order;
+		++next_order;
+		m_stack.push_back(area);
+		m_on_stack[area] = 1;
+		m_calls.emplace_back(area, graph.GetEdgesBegin(area));
+	};
+
+	for (auto root : m_region) {
+		if (m_order[root] != INVALID_COMPONENT) {
+			continue;
+		}
+		enter(root);
+		while (!m_calls.empty()) {
+			const auto area = m_calls.back().first;
+			auto& edge = m_calls.back().second;
+			if (edge != graph.GetEdgesEnd(area)) {
+				const auto next = graph.GetEdgeTarget(edge++);
+				if (graph.IsBlocked(next)) {
+					continue;
+				}
+				if (m_order[next] == INVALID_COMPONENT) {
+					enter(next);
+				}
+				else if (m_on_stack[next]) {
+					m_lowlinks[area] = std::min(m_lowlinks[area], m_order[next]);
+				}
+				continue;
+			}
+
+			m_calls.pop_back();
+			if (!m_calls.empty()) {
+				const auto caller = m_calls.back().first;
+				m_lowlinks[caller] = std::min(m_lowlinks[caller], m_lowlinks[area]);
+			}
+			if (m_lowlinks[area] == m_order[area]) {
+				uint32_t member;
+				do {
+					member = m_stack.back();
+					m_stack.pop_back();
+					m_on_stack[member] = 0;
+					m_strong[member] = next_strong;
+				} while (member != area);
+				++next_strong;
+			}
+		}
+	}
+}
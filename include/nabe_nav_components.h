@@ -0,0 +1,73 @@
+#ifndef NABENABE_NAV_COMPONENTS_H
+#define NABENABE_NAV_COMPONENTS_H
+
+#include "nabe_nav_graph.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Purpose: Connected components of a map's unblocked nav areas, for rejecting queries that have no path
+// without searching. A failing search would otherwise expand every area it can reach before giving up.
+//
+// Areas in different weakly connected components can never reach each other. Within a weak component,
+// the strongly connected components are numbered in reverse topological order, so that a connection between
+// two of them always leads to a lower number. An area can then only reach areas of an equal or lower number;
+// the one way drops leading out of a strong component can't be climbed back.
+class NABE_NavComponents
+{
+public:
+	static constexpr uint32_t INVALID_COMPONENT = UINT32_MAX;
+
+	void Build(const NABE_NavGraph& graph);
+
+	// Update the components after the blocked state of the given areas has changed.
+	// Only the weak components containing, or adjacent to, the changed areas are recomputed.
+	void Update(const NABE_NavGraph& graph, const std::vector<uint32_t>& changed_areas);
+
+	// False if there is certainly no path between the areas. True doesn't guarantee a path:
+	// for areas in different strong components, the order of the components is only a necessary condition.
+	bool MayReach(uint32_t from, uint32_t to) const
+	{
+		if (m_weak[from] == INVALID_COMPONENT || m_weak[to] == INVALID_COMPONENT) {
+			return false;
+		}
+		return m_weak[from] == m_weak[to] && m_strong[from] >= m_strong[to];
+	}
+
+	// True if the areas certainly have a path between them.
+	bool IsStronglyConnected(uint32_t from, uint32_t to) const
+	{
+		return m_weak[from] != INVALID_COMPONENT && m_weak[from] == m_weak[to] && m_strong[from] == m_strong[to];
+	}
+
+	bool IsBuilt() const { return !m_weak.empty(); }
+
+	size_t GetNumWeakComponents() const { return m_num_weak; }
+
+private:
+	// Find the weak component of the unblocked root area by flood fill, give it a new id,
+	// and number its strong components. Returns the number of areas in the component.
+	size_t BuildComponent(const NABE_NavGraph& graph, uint32_t root);
+	// Tarjan's algorithm over the areas of m_region.
+	void NumberStrongComponents(const NABE_NavGraph& graph);
+
+private:
+	// Components of each area, or INVALID_COMPONENT for blocked areas.
+	std::vector<uint32_t> m_weak;
+	std::vector<uint32_t> m_strong;
+
+	// Ids of recomputed components are never reused, so that stale ones can't collide with them.
+	uint32_t m_next_weak = 0;
+	size_t m_num_weak = 0;
+
+	// Scratch memory of the current recomputation.
+	std::vector<uint32_t> m_region;
+	std::vector<uint32_t> m_order;
+	std::vector<uint32_t> m_lowlinks;
+	std::vector<char> m_on_stack;
+	std::vector<uint32_t> m_stack;
+	std::vector<std::pair<uint32_t, uint32_t>> m_calls;
+};
+
+#endif // NABENABE_NAV_COMPONENTS_H
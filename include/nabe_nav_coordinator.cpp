@@ -11,7 +11,9 @@
 #include <list>
 
 NABE_NavCoordinator::NABE_NavCoordinator(NABE_PathFinder* owner, const std::string& map_name, const char* maps_path, const char* navs_path)
-	: m_owner(owner), m_maps_path(maps_path), m_navs_path(navs_path), m_loaded(false)
+	: m_owner(owner), m_maps_path(maps_path), m_navs_path(navs_path), m_loaded(false),
+	m_path_cache(owner->GetPathCacheSize()),
+	m_goal_trees(owner->GetGoalTreeCacheSize(), owner->GetGoalTreeMinRequests())
 {
 	m_map = new NABE_GameMap(m_owner->GetMapFolderPath(), map_name);
 	m_loaded = LoadMapNavData();
@@ -500,6 +502,16 @@ bool NABE_NavCoordinator::LoadMapNavData()
 						return false;
 					}
 				}
+				else if (strcontains(p.section, "team_") && streq(p.key, "earliest_occupy_time")) {
+					const size_t number_start_index = strlen("team_");
+					if (!isdigit(p.section[number_start_index])) {
+						print(Error, "%s: Team doesn't end with a positive integer: \"%s\"", __FUNCTION__, p.section);
+						delete entry;
+						return false;
+					}
+					const int team_index = std::stoi(std::string{ p.section + number_start_index });
+					m_pending_earliest_occupy_times.push_back({ entry, { team_index, strtof(p.value, nullptr) } });
+				}
 				else if (strcontains(p.section, "area_") && strcontains(p.key, "_area_")) {
 					const size_t number_start_index = strlen("area_");
 					if (!isdigit(p.section[number_start_index])) {
@@ -633,8 +645,21 @@ bool NABE_NavCoordinator::LoadMapNavData()
 
 	for (auto& area : m_areas) {
 		area->CalculateCenter();
+		m_areas_by_id[area->GetID()] = area;
 	}
 
+	m_graph.Build(m_areas, m_owner->GetEdgeCostModel());
+	m_components.Build(m_graph);
+
+	m_teams.Init(&m_graph);
+	for (auto& pending : m_pending_earliest_occupy_times) {
+		if (!m_teams.SetEarliestOccupyTime(pending.first->GetID(), pending.second.first, pending.second.second)) {
+			print(Warning, "%s: Invalid earliest occupy time of area %d for team %d", __FUNCTION__,
+				pending.first->GetID(), pending.second.first);
+		}
+	}
+	m_pending_earliest_occupy_times.clear();
+
 	return true;
 }
 
@@ -857,6 +882,11 @@ bool NABE_NavCoordinator::SetSpotEncounter_ToArea(SpotEncounter* target, const i
 
 NABE_Area* NABE_NavCoordinator::GetAreaById(const int id)
 {
+	if (!m_areas_by_id.empty()) {
+		auto it = m_areas_by_id.find(id);
+		return (it == m_areas_by_id.end()) ? nullptr : it->second;
+	}
+
 	for (auto& area : m_areas) {
 		if (area->GetID() == id) {
 			return area;
@@ -4,10 +4,20 @@
 #include "thirdparty/source-sdk-stubs/nav.h"
 
 #include "nabe_area.h"
+#include "nabe_danger_field.h"
+#include "nabe_first_move_table.h"
 #include "nabe_gamemap.h"
-
+#include "nabe_goal_tree_cache.h"
+#include "nabe_landmarks.h"
+#include "nabe_nav_components.h"
+#include "nabe_nav_graph.h"
+#include "nabe_nav_teams.h"
+#include "nabe_path_cache.h"
+
+#include <map>
 #include <vector>
 #include <string>
+#include <unordered_map>
 
 class NABE_Area;
 class NABE_PathFinder;
@@ -37,6 +47,33 @@ private:
 	NABE_PathFinder* m_owner;
 
 	std::vector<NABE_Area*> m_areas;
+	// Area id lookup, populated once all of the nav data has been loaded.
+	std::unordered_map<int, NABE_Area*> m_areas_by_id;
+
+	NABE_PathCache m_path_cache;
+
+	// Flat copy of the area connections, for searches that don't go through NavAreaBuildPath.
+	NABE_NavGraph m_graph;
+
+	// For failing the queries between disconnected areas without a search.
+	NABE_NavComponents m_components;
+
+	// Scratch memory of the pathfinder's own searches over m_graph.
+	NABE_NavSearch m_search;
+
+	// For the route options listed in NABE_PathFinder::SetLandmarks.
+	std::map<NABE_RouteOptions, NABE_Landmarks> m_landmarks;
+
+	// For the safest routes, by danger layer (see NABE_PathFinder::AddDangerLayer). Created on first use.
+	std::map<int, NABE_DangerField> m_danger;
+
+	// For the team aware routes, see NABE_RouteOptions::round_time.
+	NABE_NavTeams m_teams;
+
+	NABE_GoalTreeCache m_goal_trees;
+
+	// Only built for small enough maps, see NABE_PathFinder::SetFirstMoveTables.
+	NABE_FirstMoveTable m_first_moves;
 
 	std::list<std::pair<NABE_Area*, int>> m_pending_area_connections_north;
 	std::list<std::pair<NABE_Area*, int>> m_pending_area_connections_east;
@@ -45,6 +82,9 @@ private:
 
 	std::list<std::pair<NABE_Area*, SpotEncounter*>> m_pending_encounter_spots;
 
+	// Earliest occupy times by team index, until the graph is built.
+	std::list<std::pair<NABE_Area*, std::pair<int, float>>> m_pending_earliest_occupy_times;
+
 	NABE_GameMap* m_map;
 	bool m_loaded;
 
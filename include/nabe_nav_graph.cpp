@@ -0,0 +1,741 @@
+#include "nabe_nav_graph.h"
+
+#include "nabe_landmarks.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <limits>
+
+void NABE_NavGraph::Build(const std::vector<NABE_Area*>& areas, NABE_EdgeCostModel cost_model)
+{
+	const auto num_areas = areas.size();
+
+	m_cost_model = cost_model;
+
+	m_areas.assign(areas.begin(), areas.end());
+	m_centers.resize(num_areas);
+	m_indices_by_id.clear();
+	for (uint32_t i = 0; i < num_areas; ++i) {
+		m_centers[i] = m_areas[i]->GetCenter();
+		m_indices_by_id[m_areas[i]->GetID()] = i;
+		areas[i]->SetGraphIndex(i);
+	}
+
+	m_edge_offsets.assign(num_areas + 1, 0);
+	m_edge_targets.clear();
+	m_edge_costs.clear();
+	m_edge_lengths.clear();
+	m_edge_attributes.clear();
+	m_edge_portals.clear();
+	std::vector<uint32_t> num_incoming(num_areas, 0);
+	for (uint32_t i = 0; i < num_areas; ++i) {
+		m_edge_offsets[i] = static_cast<uint32_t>(m_edge_targets.size());
+		for (int dir = NORTH; dir != NUM_DIRECTIONS; ++dir) {
+			for (auto& connection : *m_areas[i]->GetAdjacentList(static_cast<NavDirType>(dir))) {
+				if (!connection.area || connection.area == m_areas[i]) {
+					continue;
+				}
+				const auto target = GetIndex(connection.area->GetID());
+				if (target == INVALID_INDEX) {
+					continue;
+				}
+				const auto portal = ComputePortal(m_areas[i], connection.area, static_cast<NavDirType>(dir));
+				const auto length = GetEdgeLength(m_areas[i], connection.area, portal, cost_model);
+				m_edge_targets.push_back(target);
+				m_edge_costs.push_back(GetTravelCost(length, connection.area->GetAttributes()));
+				m_edge_lengths.push_back(length);
+				m_edge_attributes.push_back(static_cast<uint16_t>(connection.area->GetAttributes()));
+				m_edge_portals.push_back(portal);
+				++num_incoming[target];
+			}
+		}
+	}
+	m_edge_offsets[num_areas] = static_cast<uint32_t>(m_edge_targets.size());
+
+	// Transpose for the incoming connections.
+	m_reverse_edge_offsets.assign(num_areas + 1, 0);
+	for (uint32_t i = 0; i < num_areas; ++i) {
+		m_reverse_edge_offsets[i + 1] = m_reverse_edge_offsets[i] + num_incoming[i];
+	}
+	m_reverse_edge_sources.resize(m_edge_targets.size());
+	m_reverse_edge_costs.resize(m_edge_targets.size());
+	m_reverse_edge_lengths.resize(m_edge_targets.size());
+	m_reverse_edge_attributes.resize(m_edge_targets.size());
+	std::vector<uint32_t> next(m_reverse_edge_offsets.begin(), m_reverse_edge_offsets.end() - 1);
+	for (uint32_t i = 0; i < num_areas; ++i) {
+		for (auto edge = GetEdgesBegin(i); edge != GetEdgesEnd(i); ++edge) {
+			const auto reverse_edge = next[m_edge_targets[edge]]++;
+			m_reverse_edge_sources[reverse_edge] = i;
+			m_reverse_edge_costs[reverse_edge] = m_edge_costs[edge];
+			m_reverse_edge_lengths[reverse_edge] = m_edge_lengths[edge];
+			m_reverse_edge_attributes[reverse_edge] = m_edge_attributes[edge];
+		}
+	}
+}
+
+uint32_t NABE_NavGraph::GetIndex(int area_id) const
+{
+	auto it = m_indices_by_id.find(area_id);
+	return (it == m_indices_by_id.end()) ? INVALID_INDEX : it->second;
+}
+
+uint32_t NABE_NavGraph::FindEdge(uint32_t from, uint32_t to) const
+{
+	if (from >= GetNumAreas()) {
+		return INVALID_INDEX;
+	}
+	for (auto edge = GetEdgesBegin(from); edge != GetEdgesEnd(from); ++edge) {
+		if (m_edge_targets[edge] == to) {
+			return edge;
+		}
+	}
+	return INVALID_INDEX;
+}
+
+NABE_Portal NABE_NavGraph::ComputePortal(const CNavArea* from, const CNavArea* to, NavDirType dir)
+{
+	const auto& extent = from->GetExtent();
+	const auto& to_extent = to->GetExtent();
+
+	// The overlap of the two areas along the side they're connected by. Areas connected without actually
+	// sharing a side (eg. drops) get the middle of the nearest parts of the sides instead.
+	Vector a, b;
+	if (dir == NORTH || dir == SOUTH) {
+		const float y = (dir == NORTH) ? extent.lo.y : extent.hi.y;
+		float lo = std::max(extent.lo.x, to_extent.lo.x);
+		float hi = std::min(extent.hi.x, to_extent.hi.x);
+		if (lo > hi) {
+			lo = hi = (lo + hi) * 0.5f;
+		}
+		a = Vector(lo, y, 0);
+		b = Vector(hi, y, 0);
+	}
+	else {
+		const float x = (dir == EAST) ? extent.hi.x : extent.lo.x;
+		float lo = std::max(extent.lo.y, to_extent.lo.y);
+		float hi = std::min(extent.hi.y, to_extent.hi.y);
+		if (lo > hi) {
+			lo = hi = (lo + hi) * 0.5f;
+		}
+		a = Vector(x, lo, 0);
+		b = Vector(x, hi, 0);
+	}
+	a.z = from->GetZ(a);
+	b.z = from->GetZ(b);
+
+	// Left is counter-clockwise of the direction of travel.
+	const auto& from_center = from->GetCenter();
+	const auto travel = to->GetCenter() - from_center;
+	const float cross_a = travel.x * (a.y - from_center.y) - travel.y * (a.x - from_center.x);
+	const float cross_b = travel.x * (b.y - from_center.y) - travel.y * (b.x - from_center.x);
+	return (cross_a >= cross_b) ? NABE_Portal{ a, b } : NABE_Portal{ b, a };
+}
+
+float NABE_NavGraph::GetEdgeLength(CNavArea* from, CNavArea* to, const NABE_Portal& portal, NABE_EdgeCostModel cost_model)
+{
+	if (cost_model == NABE_EdgeCostModel::Centers) {
+		return (to->GetCenter() - from->GetCenter()).Length();
+	}
+
+	const auto middle = (portal.left + portal.right) * 0.5f;
+	float length = (middle - from->GetCenter()).Length() + (to->GetCenter() - middle).Length();
+
+	// Climbing up takes jumping, so it costs its height once more. Dropping down is no slower than walking.
+	const float height_change = from->ComputeHeightChange(to);
+	if (height_change > 0.0f) {
+		length += height_change;
+	}
+	return length;
+}
+
+void NABE_NavGraph::SmoothPath(const std::vector<uint32_t>& path, const Vector& start, const Vector& goal,
+	std::vector<Vector>& out_waypoints) const
+{
+	out_waypoints.clear();
+
+	std::vector<NABE_Portal> portals;
+	portals.reserve(path.size() + 1);
+	portals.push_back({ start, start });
+	for (size_t i = 1; i < path.size(); ++i) {
+		const auto edge = FindEdge(path[i - 1], path[i]);
+		if (edge == INVALID_INDEX) {
+			// Not adjacent after all, so the path must go through the center, as if unsmoothed.
+			portals.push_back({ m_centers[path[i]], m_centers[path[i]] });
+		}
+		else {
+			portals.push_back(m_edge_portals[edge]);
+		}
+	}
+	portals.push_back({ goal, goal });
+
+	// Twice the signed area of the triangle, positive if c is counter-clockwise (left) of a -> b.
+	auto cross = [](const Vector& a, const Vector& b, const Vector& c) {
+		return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+	};
+	auto same = [](const Vector& a, const Vector& b) {
+		return (a - b).LengthSqr() < 0.001f;
+	};
+
+	Vector apex = start;
+	Vector left = start;
+	Vector right = start;
+	size_t left_index = 0;
+	size_t right_index = 0;
+	out_waypoints.push_back(start);
+
+	for (size_t i = 1; i < portals.size(); ++i) {
+		const auto& portal = portals[i];
+
+		// Narrow the funnel from the right, unless the new right side crosses over the left side,
+		// in which case the left side is a corner of the path, and the funnel starts anew from there.
+		if (cross(apex, right, portal.right) >= 0.0f) {
+			if (same(apex, right) || cross(apex, left, portal.right) < 0.0f) {
+				right = portal.right;
+				right_index = i;
+			}
+			else {
+				apex = left;
+				out_waypoints.push_back(apex);
+				right = apex;
+				i = right_index = left_index;
+				continue;
+			}
+		}
+
+		// Same for the left.
+		if (cross(apex, left, portal.left) <= 0.0f) {
+			if (same(apex, left) || cross(apex, right, portal.left) > 0.0f) {
+				left = portal.left;
+				left_index = i;
+			}
+			else {
+				apex = right;
+				out_waypoints.push_back(apex);
+				left = apex;
+				i = left_index = right_index;
+				continue;
+			}
+		}
+	}
+
+	if (!same(out_waypoints.back(), goal)) {
+		out_waypoints.push_back(goal);
+	}
+}
+
+uint64_t NABE_NavGraph::GetHash() const
+{
+	// FNV-1a
+	uint64_t hash = 14695981039346656037ULL;
+	auto add = [&hash](const void* data, size_t size) {
+		for (size_t i = 0; i < size; ++i) {
+			hash ^= static_cast<const unsigned char*>(data)[i];
+			hash *= 1099511628211ULL;
+		}
+	};
+
+	for (auto& area : m_areas) {
+		const auto id = area->GetID();
+		add(&id, sizeof(id));
+	}
+	add(m_edge_offsets.data(), m_edge_offsets.size() * sizeof(m_edge_offsets[0]));
+	add(m_edge_targets.data(), m_edge_targets.size() * sizeof(m_edge_targets[0]));
+	add(m_edge_costs.data(), m_edge_costs.size() * sizeof(m_edge_costs[0]));
+	return hash;
+}
+
+float NABE_NavGraph::GetTravelCost(const CNavArea* from, const CNavArea* to)
+{
+	return GetTravelCost((to->GetCenter() - from->GetCenter()).Length(), to->GetAttributes());
+}
+
+float NABE_NavGraph::GetTravelCost(float dist, int attributes)
+{
+	float cost = dist;
+
+	if (attributes & NAV_MESH_CROUCH) {
+		const float crouchPenalty = 20.0f;
+		cost += crouchPenalty * dist;
+	}
+	if (attributes & NAV_MESH_JUMP) {
+		const float jumpPenalty = 5.0f;
+		cost += jumpPenalty * dist;
+	}
+	return cost;
+}
+
+bool NABE_NavGraph::FindPath(uint32_t from, uint32_t to, NABE_NavSearch& search, std::vector<uint32_t>& out_path) const
+{
+	if (to >= GetNumAreas()) {
+		out_path.clear();
+		return false;
+	}
+
+	// Every step costs at least the straight line distance it covers, so this never overestimates.
+	const auto& goal = m_centers[to];
+	auto heuristic = [&](uint32_t index) { return (m_centers[index] - goal).Length(); };
+	auto edge_cost = [&](uint32_t edge) { return m_edge_costs[edge]; };
+	return Search(from, to, search, out_path, edge_cost, heuristic);
+}
+
+bool NABE_NavGraph::FindPath(uint32_t from, uint32_t to, const NABE_RouteOptions& route, NABE_NavSearch& search,
+	std::vector<uint32_t>& out_path, const NABE_Landmarks* landmarks, NABE_SearchBudget* budget, uint32_t* out_closest) const
+{
+	if (out_closest) {
+		*out_closest = INVALID_INDEX;
+	}
+	if (to >= GetNumAreas()) {
+		out_path.clear();
+		return false;
+	}
+
+	const int avoid = route.avoid_attributes;
+	const int penalized = ~route.allow_attributes;
+	auto edge_cost = [&](uint32_t edge) {
+		const int attributes = m_edge_attributes[edge];
+		if (attributes & avoid) {
+			return -1.0f;
+		}
+		return GetTravelCost(m_edge_lengths[edge], attributes & penalized);
+	};
+
+	const auto& goal = m_centers[to];
+	if (landmarks) {
+		// Both never overestimate, so neither does the tighter of the two.
+		auto heuristic = [&](uint32_t index) {
+			return std::max((m_centers[index] - goal).Length(), landmarks->GetLowerBound(index, to));
+		};
+		return Search(from, to, search, out_path, edge_cost, heuristic, budget, out_closest);
+	}
+	auto heuristic = [&](uint32_t index) { return (m_centers[index] - goal).Length(); };
+	return Search(from, to, search, out_path, edge_cost, heuristic, budget, out_closest);
+}
+
+void NABE_NavGraph::GetSearchPath(const NABE_NavSearch& search, uint32_t area, std::vector<uint32_t>& out_path) const
+{
+	out_path.clear();
+	for (auto i = area; i != INVALID_INDEX && out_path.size() <= GetNumAreas(); i = search.GetParent(i)) {
+		out_path.push_back(i);
+	}
+	std::reverse(out_path.begin(), out_path.end());
+}
+
+size_t NABE_NavGraph::FindPaths(uint32_t from, const std::vector<uint32_t>& goals, const NABE_RouteOptions& route,
+	NABE_NavSearch& search, std::vector<std::vector<uint32_t>>& out_paths, NABE_SearchBudget* budget) const
+{
+	constexpr auto unreachable = std::numeric_limits<float>::infinity();
+
+	out_paths.assign(goals.size(), {});
+	if (budget) {
+		budget->exhausted = false;
+	}
+	if (from >= GetNumAreas() || IsBlocked(from)) {
+		return 0;
+	}
+
+	// Distinct goals not reached yet.
+	std::vector<uint32_t> remaining;
+	for (auto goal : goals) {
+		if (goal < GetNumAreas() && !IsBlocked(goal) && std::find(remaining.begin(), remaining.end(), goal) == remaining.end()) {
+			remaining.push_back(goal);
+		}
+	}
+	if (remaining.empty()) {
+		return 0;
+	}
+
+	const int avoid = route.avoid_attributes;
+	const int penalized = ~route.allow_attributes;
+	auto heuristic = [&](uint32_t index) {
+		float nearest = unreachable;
+		for (auto goal : remaining) {
+			nearest = std::min(nearest, (m_centers[index] - m_centers[goal]).Length());
+		}
+		return nearest;
+	};
+
+	size_t num_found = 0;
+	auto add_paths = [&](uint32_t goal) {
+		std::vector<uint32_t> path;
+		for (auto i = goal; i != INVALID_INDEX; i = search.GetParent(i)) {
+			path.push_back(i);
+		}
+		std::reverse(path.begin(), path.end());
+		for (size_t i = 0; i < goals.size(); ++i) {
+			if (goals[i] == goal) {
+				out_paths[i] = path;
+				++num_found;
+			}
+		}
+	};
+
+	search.Reset(GetNumAreas());
+	search.Visit(from, 0, INVALID_INDEX);
+	search.Push(heuristic(from), from);
+
+	// Same budget checks as Search.
+	const auto search_start = std::chrono::steady_clock::now();
+	constexpr size_t clock_check_interval = 64;
+	size_t num_expansions = 0;
+
+	// The heuristic only grows as goals are reached, so the priorities already queued still never overestimate,
+	// and each goal's cost is final once it's popped. Areas may be expanded again if reached cheaper later.
+	float priority;
+	uint32_t area;
+	while (!remaining.empty() && search.Pop(priority, area)) {
+		if (budget) {
+			if ((budget->max_expansions != 0 && num_expansions >= budget->max_expansions) ||
+				(budget->max_microseconds != 0 && num_expansions % clock_check_interval == 0 &&
+					std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - search_start).count() >=
+						budget->max_microseconds))
+			{
+				budget->exhausted = true;
+				break;
+			}
+		}
+
+		const auto cost_so_far = search.GetCost(area);
+		if (priority > cost_so_far + heuristic(area)) {
+			continue; // Outdated entry; this area was reached cheaper since.
+		}
+
+		auto goal = std::find(remaining.begin(), remaining.end(), area);
+		if (goal != remaining.end()) {
+			remaining.erase(goal);
+			add_paths(area);
+			if (remaining.empty()) {
+				break;
+			}
+		}
+
+		for (auto edge = GetEdgesBegin(area); edge != GetEdgesEnd(area); ++edge) {
+			const auto next = m_edge_targets[edge];
+			const int attributes = m_edge_attributes[edge];
+			if ((attributes & avoid) || IsBlocked(next)) {
+				continue;
+			}
+			const auto new_cost = cost_so_far + GetTravelCost(m_edge_lengths[edge], attributes & penalized);
+			if (search.IsVisited(next) && search.GetCost(next) <= new_cost) {
+				continue;
+			}
+			search.Visit(next, new_cost, area);
+			search.Push(new_cost + heuristic(next), next);
+		}
+		++num_expansions;
+	}
+
+	return num_found;
+}
+
+template <typename EdgeCost, typename Heuristic>
+bool NABE_NavGraph::Search(uint32_t from, uint32_t to, NABE_NavSearch& search, std::vector<uint32_t>& out_path,
+	const EdgeCost& edge_cost, const Heuristic& heuristic, NABE_SearchBudget* budget, uint32_t* out_closest) const
+{
+	constexpr auto unreachable = std::numeric_limits<float>::infinity();
+
+	out_path.clear();
+	if (budget) {
+		budget->exhausted = false;
+	}
+	if (out_closest) {
+		*out_closest = INVALID_INDEX;
+	}
+	if (from >= GetNumAreas() || to >= GetNumAreas() || IsBlocked(to)) {
+		return false;
+	}
+	if (from == to) {
+		out_path.push_back(to);
+		return true;
+	}
+	if (IsBlocked(from)) {
+		return false;
+	}
+
+	search.Reset(GetNumAreas());
+	search.Visit(from, 0, INVALID_INDEX);
+	search.Push(heuristic(from), from);
+
+	// Like NavAreaBuildPath, the closest area is the one reached with the lowest estimate of the remaining cost.
+	float closest_estimate = heuristic(from);
+	if (out_closest) {
+		*out_closest = from;
+	}
+
+	// The clock is only read every few expansions, since that costs more than an expansion itself.
+	const auto search_start = std::chrono::steady_clock::now();
+	constexpr size_t clock_check_interval = 64;
+	size_t num_expansions = 0;
+
+	float priority;
+	uint32_t area;
+	while (search.Pop(priority, area)) {
+		if (budget) {
+			if ((budget->max_expansions != 0 && num_expansions >= budget->max_expansions) ||
+				(budget->max_microseconds != 0 && num_expansions % clock_check_interval == 0 &&
+					std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - search_start).count() >=
+						budget->max_microseconds))
+			{
+				budget->exhausted = true;
+				return false;
+			}
+		}
+
+		const auto cost_so_far = search.GetCost(area);
+		if (priority > cost_so_far + heuristic(area)) {
+			continue; // Outdated entry; this area was reached cheaper since.
+		}
+
+		if (area == to) {
+			for (auto i = to; i != INVALID_INDEX; i = search.GetParent(i)) {
+				out_path.push_back(i);
+			}
+			std::reverse(out_path.begin(), out_path.end());
+			return true;
+		}
+
+		for (auto edge = GetEdgesBegin(area); edge != GetEdgesEnd(area); ++edge) {
+			const auto next = m_edge_targets[edge];
+			const auto cost = edge_cost(edge);
+			if (cost < 0 || IsBlocked(next)) {
+				continue;
+			}
+			const auto new_cost = cost_so_far + cost;
+			if (search.IsVisited(next) && search.GetCost(next) <= new_cost) {
+				continue;
+			}
+			const auto estimate = heuristic(next);
+			if (estimate == unreachable) {
+				continue;
+			}
+			search.Visit(next, new_cost, area);
+			search.Push(new_cost + estimate, next);
+			if (estimate < closest_estimate) {
+				closest_estimate = estimate;
+				if (out_closest) {
+					*out_closest = next;
+				}
+			}
+		}
+		++num_expansions;
+	}
+
+	return false;
+}
+
+void NABE_NavGraph::ComputeCosts(uint32_t source, bool backwards, const NABE_RouteOptions& route, NABE_NavSearch& search,
+	std::vector<float>& out_costs) const
+{
+	out_costs.assign(GetNumAreas(), std::numeric_limits<float>::infinity());
+	if (source >= GetNumAreas()) {
+		return;
+	}
+
+	const int penalized = ~route.allow_attributes;
+	const auto& offsets = (backwards ? m_reverse_edge_offsets : m_edge_offsets);
+	const auto& neighbours = (backwards ? m_reverse_edge_sources : m_edge_targets);
+	const auto& lengths = (backwards ? m_reverse_edge_lengths : m_edge_lengths);
+	const auto& attributes = (backwards ? m_reverse_edge_attributes : m_edge_attributes);
+
+	search.Reset(GetNumAreas());
+	search.Visit(source, 0, INVALID_INDEX);
+	search.Push(0, source);
+
+	float cost;
+	uint32_t area;
+	while (search.Pop(cost, area)) {
+		if (cost > search.GetCost(area)) {
+			continue; // Outdated entry.
+		}
+		out_costs[area] = cost;
+
+		for (auto edge = offsets[area]; edge != offsets[area + 1]; ++edge) {
+			// Going backwards, the edge leads into the area we came from, so it's that area's attributes that count.
+			if (attributes[edge] & route.avoid_attributes) {
+				continue;
+			}
+			const auto next = neighbours[edge];
+			const auto new_cost = cost + GetTravelCost(lengths[edge], attributes[edge] & penalized);
+			if (search.IsVisited(next) && search.GetCost(next) <= new_cost) {
+				continue;
+			}
+			search.Visit(next, new_cost, area);
+			search.Push(new_cost, next);
+		}
+	}
+}
+
+void NABE_NavGraph::BuildShortestPathTree(uint32_t goal, NABE_NavSearch& search, std::vector<uint32_t>& out_next_hops,
+	std::vector<float>* out_costs) const
+{
+	out_next_hops.assign(GetNumAreas(), INVALID_INDEX);
+	if (out_costs) {
+		out_costs->assign(GetNumAreas(), std::numeric_limits<float>::infinity());
+	}
+	if (goal >= GetNumAreas() || IsBlocked(goal)) {
+		return;
+	}
+
+	search.Reset(GetNumAreas());
+	search.Visit(goal, 0, INVALID_INDEX);
+	search.Push(0, goal);
+
+	float cost_to_goal;
+	uint32_t area;
+	while (search.Pop(cost_to_goal, area)) {
+		if (cost_to_goal > search.GetCost(area)) {
+			continue; // Outdated entry.
+		}
+		out_next_hops[area] = search.GetParent(area);
+		if (out_costs) {
+			(*out_costs)[area] = cost_to_goal;
+		}
+
+		for (auto edge = GetReverseEdgesBegin(area); edge != GetReverseEdgesEnd(area); ++edge) {
+			const auto prev = m_reverse_edge_sources[edge];
+			if (IsBlocked(prev)) {
+				continue;
+			}
+			const auto new_cost = cost_to_goal + m_reverse_edge_costs[edge];
+			if (search.IsVisited(prev) && search.GetCost(prev) <= new_cost) {
+				continue;
+			}
+			search.Visit(prev, new_cost, area);
+			search.Push(new_cost, prev);
+		}
+	}
+}
+
+void NABE_NavGraph::RepairShortestPathTree(uint32_t goal, const std::vector<uint32_t>& changed_areas, NABE_NavSearch& search,
+	std::vector<uint32_t>& next_hops, std::vector<float>& costs) const
+{
+	constexpr auto no_path = std::numeric_limits<float>::infinity();
+
+	// The goal itself changed, so every route changes.
+	if (goal >= GetNumAreas() || IsBlocked(goal) || costs[goal] != 0) {
+		BuildShortestPathTree(goal, search, next_hops, &costs);
+		return;
+	}
+
+	// Areas routing through a newly blocked area are the subtree below it. Forget their routes.
+	std::vector<uint32_t> lost;
+	for (auto area : changed_areas) {
+		if (IsBlocked(area) && costs[area] != no_path) {
+			costs[area] = no_path;
+			next_hops[area] = INVALID_INDEX;
+			lost.push_back(area);
+		}
+	}
+	for (size_t i = 0; i < lost.size(); ++i) {
+		const auto area = lost[i];
+		for (auto edge = GetReverseEdgesBegin(area); edge != GetReverseEdgesEnd(area); ++edge) {
+			const auto prev = m_reverse_edge_sources[edge];
+			if (next_hops[prev] == area) {
+				costs[prev] = no_path;
+				next_hops[prev] = INVALID_INDEX;
+				lost.push_back(prev);
+			}
+		}
+	}
+
+	// Every other area still has a valid route, though maybe no longer the shortest.
+	// Give the lost areas, and the newly unblocked areas, their best route through a neighbour that still has one.
+	search.Reset(GetNumAreas());
+	auto reconnect = [&](uint32_t area) {
+		if (IsBlocked(area)) {
+			return;
+		}
+		for (auto edge = GetEdgesBegin(area); edge != GetEdgesEnd(area); ++edge) {
+			const auto next = m_edge_targets[edge];
+			const auto new_cost = costs[next] + m_edge_costs[edge];
+			if (!IsBlocked(next) && new_cost < costs[area]) {
+				costs[area] = new_cost;
+				next_hops[area] = next;
+			}
+		}
+		if (costs[area] != no_path) {
+			search.Push(costs[area], area);
+		}
+	};
+	for (auto area : lost) {
+		reconnect(area);
+	}
+	for (auto area : changed_areas) {
+		reconnect(area);
+	}
+
+	// Then spread any improvements backwards, as in BuildShortestPathTree.
+	float cost_to_goal;
+	uint32_t area;
+	while (search.Pop(cost_to_goal, area)) {
+		if (cost_to_goal > costs[area]) {
+			continue; // Outdated entry.
+		}
+		for (auto edge = GetReverseEdgesBegin(area); edge != GetReverseEdgesEnd(area); ++edge) {
+			const auto prev = m_reverse_edge_sources[edge];
+			const auto new_cost = cost_to_goal + m_reverse_edge_costs[edge];
+			if (IsBlocked(prev) || costs[prev] <= new_cost) {
+				continue;
+			}
+			costs[prev] = new_cost;
+			next_hops[prev] = area;
+			search.Push(new_cost, prev);
+		}
+	}
+}
+
+bool NABE_NavGraph::WalkShortestPathTree(const std::vector<uint32_t>& next_hops, uint32_t from, uint32_t goal,
+	std::vector<uint32_t>& out_path) const
+{
+	out_path.clear();
+	if (from >= next_hops.size() || goal >= next_hops.size()) {
+		return false;
+	}
+
+	for (auto area = from; area != goal; area = next_hops[area]) {
+		// Also guards against looping forever, should the tree be broken.
+		if (area == INVALID_INDEX || out_path.size() >= next_hops.size()) {
+			out_path.clear();
+			return false;
+		}
+		out_path.push_back(area);
+	}
+	out_path.push_back(goal);
+	return true;
+}
+
+void NABE_NavGraph::GetPath(const std::vector<uint32_t>& indices, std::list<CNavArea*>& out_path) const
+{
+	for (auto& index : indices) {
+		out_path.push_back(m_areas[index]);
+	}
+}
+
+void NABE_NavSearch::Reset(size_t num_areas)
+{
+	if (m_visited.size() != num_areas || ++m_generation == 0) {
+		m_visited.assign(num_areas, 0);
+		m_costs.resize(num_areas);
+		m_parents.resize(num_areas);
+		m_generation = 1;
+	}
+	m_heap.clear();
+}
+
+void NABE_NavSearch::Push(float priority, uint32_t index)
+{
+	m_heap.emplace_back(priority, index);
+	std::push_heap(m_heap.begin(), m_heap.end(), std::greater<std::pair<float, uint32_t>>());
+}
+
+bool NABE_NavSearch::Pop(float& out_priority, uint32_t& out_index)
+{
+	if (m_heap.empty()) {
+		return false;
+	}
+	std::pop_heap(m_heap.begin(), m_heap.end(), std::greater<std::pair<float, uint32_t>>());
+	out_priority = m_heap.back().first;
+	out_index = m_heap.back().second;
+	m_heap.pop_back();
+	return true;
+}
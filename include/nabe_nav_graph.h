@@ -0,0 +1,209 @@
+#ifndef NABENABE_NAV_GRAPH_H
+#define NABENABE_NAV_GRAPH_H
+
+#include "nabe_area.h"
+#include "nabe_route_options.h"
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class NABE_Landmarks;
+class NABE_NavSearch;
+
+// How the length of a move from an area to an adjacent one is measured.
+enum class NABE_EdgeCostModel {
+	// Straight from center to center, like CostFunctor of nav_pathfind.h.
+	Centers,
+	// From the center to the middle of the portal between the areas, and from there on to the other center,
+	// plus the height of any climb (see NABE_NavGraph::GetEdgeLength). Never shorter than Centers, so the
+	// straight line heuristics stay consistent.
+	Portals,
+};
+
+// Purpose: Limits of a single search over a NABE_NavGraph, like NavSearchBudget of nav_pathfind.h.
+// Zero means no limit.
+struct NABE_SearchBudget {
+	size_t max_expansions = 0;
+	long long max_microseconds = 0;
+
+	// Set by the search if it gave up because of the limits.
+	bool exhausted = false;
+};
+
+// Purpose: The part of an area's side that leads into an adjacent area, with its ends as seen when moving
+// along the connection.
+struct NABE_Portal {
+	Vector left;
+	Vector right;
+};
+
+// Purpose: Read-only copy of a map's nav area connections, stored as flat arrays (compressed sparse rows),
+// so that it can be searched quickly, and by several threads at once.
+// Areas are referred to by their index in the graph, rather than their nav area id.
+class NABE_NavGraph
+{
+public:
+	static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+	// Also sets the graph index of each area (see NABE_Area::GetGraphIndex).
+	void Build(const std::vector<NABE_Area*>& areas, NABE_EdgeCostModel cost_model = NABE_EdgeCostModel::Centers);
+
+	NABE_EdgeCostModel GetCostModel() const { return m_cost_model; }
+
+	size_t GetNumAreas() const { return m_areas.size(); }
+	size_t GetNumEdges() const { return m_edge_targets.size(); }
+	// Identifies the layout of the graph, for checking whether data derived from it (eg. stored on disk) is still valid.
+	uint64_t GetHash() const;
+	uint32_t GetIndex(int area_id) const;
+	// Same, without a lookup. All of the graph's areas are NABE_Areas.
+	static uint32_t GetIndex(const CNavArea* area) { return static_cast<const NABE_Area*>(area)->GetGraphIndex(); }
+	CNavArea* GetArea(uint32_t index) const { return m_areas[index]; }
+	const Vector& GetCenter(uint32_t index) const { return m_centers[index]; }
+	bool IsBlocked(uint32_t index) const { return m_areas[index]->IsBlocked(); }
+
+	// Outgoing connections of an area are the edges [GetEdgesBegin, GetEdgesEnd).
+	uint32_t GetEdgesBegin(uint32_t index) const { return m_edge_offsets[index]; }
+	uint32_t GetEdgesEnd(uint32_t index) const { return m_edge_offsets[index + 1]; }
+	uint32_t GetEdgeTarget(uint32_t edge) const { return m_edge_targets[edge]; }
+	float GetEdgeCost(uint32_t edge) const { return m_edge_costs[edge]; }
+	// Length of the move, as measured by the cost model, before any penalties of the area it leads to.
+	float GetEdgeLength(uint32_t edge) const { return m_edge_lengths[edge]; }
+	// Attributes (NAV_MESH_*) of the area an edge leads to, so that route options filter edges with a single AND.
+	int GetEdgeAttributes(uint32_t edge) const { return m_edge_attributes[edge]; }
+	const NABE_Portal& GetEdgePortal(uint32_t edge) const { return m_edge_portals[edge]; }
+	// The edge from an area to an adjacent one, or INVALID_INDEX if there is no such connection.
+	uint32_t FindEdge(uint32_t from, uint32_t to) const;
+
+	// Incoming connections, for searching backwards from a goal. Edges refer to the same costs as above.
+	uint32_t GetReverseEdgesBegin(uint32_t index) const { return m_reverse_edge_offsets[index]; }
+	uint32_t GetReverseEdgesEnd(uint32_t index) const { return m_reverse_edge_offsets[index + 1]; }
+	uint32_t GetReverseEdgeSource(uint32_t edge) const { return m_reverse_edge_sources[edge]; }
+	float GetReverseEdgeCost(uint32_t edge) const { return m_reverse_edge_costs[edge]; }
+
+	// Cost of moving from an area to an adjacent one. Same as CostFunctor of nav_pathfind.h.
+	static float GetTravelCost(const CNavArea* from, const CNavArea* to);
+	// Same, for a move of the given distance into an area with the given attributes.
+	static float GetTravelCost(float dist, int attributes);
+
+	// A* search between two areas, with the same costs as NavAreaBuildPath.
+	// Thread safe, as long as each thread uses its own search state.
+	bool FindPath(uint32_t from, uint32_t to, NABE_NavSearch& search, std::vector<uint32_t>& out_path) const;
+
+	// Same, with the costs of the route options. If landmarks built for the same options are given,
+	// they guide the search towards the goal, so that it expands fewer areas.
+	// If a budget is given, the search gives up once it runs out. If out_closest is given, it receives the area
+	// closest to the goal that the search reached (the start if none), whose path GetSearchPath then gives.
+	bool FindPath(uint32_t from, uint32_t to, const NABE_RouteOptions& route, NABE_NavSearch& search,
+		std::vector<uint32_t>& out_path, const NABE_Landmarks* landmarks = nullptr,
+		NABE_SearchBudget* budget = nullptr, uint32_t* out_closest = nullptr) const;
+
+	// The path from the start of the latest search to an area it reached, following the parents the search left.
+	void GetSearchPath(const NABE_NavSearch& search, uint32_t area, std::vector<uint32_t>& out_path) const;
+
+	// A single A* search from one area to several goals, with the costs of the route options, until all of the goals
+	// are reached. The heuristic is the distance to the nearest goal not yet reached.
+	// out_paths receives a path per goal, in the same order, left empty for the goals that can't be reached,
+	// or weren't before the budget (if given) ran out. Returns the number of goals reached.
+	size_t FindPaths(uint32_t from, const std::vector<uint32_t>& goals, const NABE_RouteOptions& route, NABE_NavSearch& search,
+		std::vector<std::vector<uint32_t>>& out_paths, NABE_SearchBudget* budget = nullptr) const;
+
+	// Dijkstra search from the source over the whole graph, with the costs of the route options.
+	// Blocked areas are searched like any other, so the costs never overestimate, whatever gets blocked later.
+	// out_costs receives the cost from the source to every area (or from every area to the source, if backwards),
+	// or infinity if there is no path.
+	void ComputeCosts(uint32_t source, bool backwards, const NABE_RouteOptions& route, NABE_NavSearch& search,
+		std::vector<float>& out_costs) const;
+
+	// Dijkstra search backwards from the goal, over the whole graph.
+	// out_next_hops receives, for every area, the next area on its shortest path to the goal,
+	// or INVALID_INDEX if the goal can't be reached from it (and for the goal itself).
+	// If out_costs is given, it receives the cost of every area's path to the goal, or infinity if there is none.
+	void BuildShortestPathTree(uint32_t goal, NABE_NavSearch& search, std::vector<uint32_t>& out_next_hops,
+		std::vector<float>* out_costs = nullptr) const;
+
+	// Update a shortest path tree and its costs after the blocked state of the given areas has changed,
+	// without searching the whole graph again. Only the areas that routed through a newly blocked area,
+	// and the areas that can now route through a newly unblocked one, are searched.
+	void RepairShortestPathTree(uint32_t goal, const std::vector<uint32_t>& changed_areas, NABE_NavSearch& search,
+		std::vector<uint32_t>& next_hops, std::vector<float>& costs) const;
+
+	// Follow the next hops of a shortest path tree from an area to the tree's goal.
+	// Returns false if the goal can't be reached.
+	bool WalkShortestPathTree(const std::vector<uint32_t>& next_hops, uint32_t from, uint32_t goal,
+		std::vector<uint32_t>& out_path) const;
+
+	void GetPath(const std::vector<uint32_t>& indices, std::list<CNavArea*>& out_path) const;
+
+	// Pull a path of areas taut through the portals between them (the funnel algorithm), so that only the corners
+	// where it has to turn remain. out_waypoints starts with start, and ends with goal.
+	void SmoothPath(const std::vector<uint32_t>& path, const Vector& start, const Vector& goal,
+		std::vector<Vector>& out_waypoints) const;
+
+private:
+	static NABE_Portal ComputePortal(const CNavArea* from, const CNavArea* to, NavDirType dir);
+	static float GetEdgeLength(CNavArea* from, CNavArea* to, const NABE_Portal& portal, NABE_EdgeCostModel cost_model);
+
+	// The A* search of FindPath. EdgeCost gives the cost of an edge, or a negative value if it must not be taken,
+	// and Heuristic the estimated cost from an area to the goal, or infinity if the goal can't be reached from it.
+	template <typename EdgeCost, typename Heuristic>
+	bool Search(uint32_t from, uint32_t to, NABE_NavSearch& search, std::vector<uint32_t>& out_path,
+		const EdgeCost& edge_cost, const Heuristic& heuristic, NABE_SearchBudget* budget = nullptr,
+		uint32_t* out_closest = nullptr) const;
+
+private:
+	NABE_EdgeCostModel m_cost_model = NABE_EdgeCostModel::Centers;
+
+	std::vector<CNavArea*> m_areas;
+	std::vector<Vector> m_centers;
+	std::unordered_map<int, uint32_t> m_indices_by_id;
+
+	std::vector<uint32_t> m_edge_offsets;
+	std::vector<uint32_t> m_edge_targets;
+	std::vector<float> m_edge_costs;
+	// For the route options: the length of the move, and the attributes of the target area.
+	std::vector<float> m_edge_lengths;
+	std::vector<uint16_t> m_edge_attributes;
+	std::vector<NABE_Portal> m_edge_portals;
+
+	std::vector<uint32_t> m_reverse_edge_offsets;
+	std::vector<uint32_t> m_reverse_edge_sources;
+	std::vector<float> m_reverse_edge_costs;
+	std::vector<float> m_reverse_edge_lengths;
+	std::vector<uint16_t> m_reverse_edge_attributes;
+};
+
+// Purpose: Scratch memory of a single search over a NABE_NavGraph. Reusable between searches.
+class NABE_NavSearch
+{
+public:
+	// Prepare for a new search over a graph of num_areas areas.
+	void Reset(size_t num_areas);
+
+	bool IsVisited(uint32_t index) const { return m_visited[index] == m_generation; }
+	float GetCost(uint32_t index) const { return m_costs[index]; }
+	uint32_t GetParent(uint32_t index) const { return m_parents[index]; }
+
+	void Visit(uint32_t index, float cost, uint32_t parent)
+	{
+		m_visited[index] = m_generation;
+		m_costs[index] = cost;
+		m_parents[index] = parent;
+	}
+
+	// Min-heap of (priority, area index), with lazy removal of outdated entries.
+	void Push(float priority, uint32_t index);
+	bool Pop(float& out_priority, uint32_t& out_index);
+
+private:
+	std::vector<uint32_t> m_visited;
+	std::vector<float> m_costs;
+	std::vector<uint32_t> m_parents;
+	std::vector<std::pair<float, uint32_t>> m_heap;
+	// Bumped every search, so the arrays never have to be cleared.
+	uint32_t m_generation = 0;
+};
+
+#endif // NABENABE_NAV_GRAPH_H
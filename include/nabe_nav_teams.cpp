@@ -0,0 +1,50 @@
+#include "nabe_nav_teams.h"
+
+#include "thirdparty/source-sdk-stubs/nav.h"
+
+#include <algorithm>
+#include <cmath>
+
+void NABE_NavTeams::Init(const NABE_NavGraph* graph)
+{
+	m_graph = graph;
+	for (auto& times : m_times) {
+		times.assign(graph->GetNumAreas(), NEVER);
+	}
+}
+
+bool NABE_NavTeams::SetEarliestOccupyTime(int area_id, int team_index, float seconds)
+{
+	const auto area = m_graph->GetIndex(area_id);
+	if (team_index < 0 || team_index >= NUM_TEAMS || area == NABE_NavGraph::INVALID_INDEX) {
+		return false;
+	}
+
+	// Rounded up, so that an area is never considered reached too early.
+	// Times too large to store (or not numbers) are as good as never.
+	const float tenths = std::ceil(seconds * 10.0f);
+	if (!(tenths < NEVER)) {
+		m_times[team_index][area] = NEVER;
+	}
+	else {
+		m_times[team_index][area] = static_cast<uint16_t>(std::max(tenths, 0.0f));
+	}
+	return true;
+}
+
+int NABE_NavTeams::GetEnemyTeam(int team)
+{
+	if (team == static_cast<int>(TEAM_JINRAI)) {
+		return TEAM_NSF;
+	}
+	if (team == static_cast<int>(TEAM_NSF)) {
+		return TEAM_JINRAI;
+	}
+	return 0;
+}
+
+int NABE_NavTeams::GetTeamIndex(int team)
+{
+	const int team_index = team - static_cast<int>(TEAM_JINRAI);
+	return (team_index >= 0 && team_index < NUM_TEAMS) ? team_index : -1;
+}
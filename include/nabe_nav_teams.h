@@ -0,0 +1,55 @@
+#ifndef NABENABE_NAV_TEAMS_H
+#define NABENABE_NAV_TEAMS_H
+
+#include "nabe_nav_graph.h"
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Purpose: The earliest time since the start of a round that each team can reach each nav area,
+// as computed into the nav mesh ("nav_teams" of the parsed nav data). Stored per team, indexed like the graph's areas,
+// in tenths of a second as 16 bits, so that a map of tens of thousands of areas only costs a few hundred KiB.
+class NABE_NavTeams
+{
+public:
+	// Playable teams of nav.h: TEAM_JINRAI and TEAM_NSF.
+	static constexpr int NUM_TEAMS = 2;
+
+	void Init(const NABE_NavGraph* graph);
+
+	bool IsBuilt() const { return m_graph != nullptr; }
+
+	// team_index is the NavTeamIdx of nav.h. Returns false for unknown teams or areas.
+	bool SetEarliestOccupyTime(int area_id, int team_index, float seconds);
+
+	// Infinity for unknown teams and areas, and for the areas the team never reaches.
+	float GetEarliestOccupyTime(uint32_t area, int team) const
+	{
+		const auto team_index = GetTeamIndex(team);
+		if (team_index < 0 || area >= m_graph->GetNumAreas() || m_times[team_index][area] == NEVER) {
+			return std::numeric_limits<float>::infinity();
+		}
+		return m_times[team_index][area] * 0.1f;
+	}
+
+	// For EnemyOccupyCost of nav_pathfind.h.
+	float GetEarliestOccupyTime(const CNavArea* area, int team) const
+	{
+		return GetEarliestOccupyTime(NABE_NavGraph::GetIndex(area), team);
+	}
+
+	// The opposing team, or 0 if the team isn't a playable one.
+	static int GetEnemyTeam(int team);
+
+private:
+	static int GetTeamIndex(int team);
+
+	static constexpr uint16_t NEVER = UINT16_MAX;
+
+private:
+	const NABE_NavGraph* m_graph = nullptr;
+	std::vector<uint16_t> m_times[NUM_TEAMS];
+};
+
+#endif // NABENABE_NAV_TEAMS_H
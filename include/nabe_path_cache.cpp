@@ -0,0 +1,69 @@
+#include "nabe_path_cache.h"
+
+#include <algorithm>
+
+bool NABE_PathCache::Get(const NABE_PathKey& key, std::list<CNavArea*>& out_path)
+{
+	if (m_capacity == 0) {
+		return false;
+	}
+
+	auto it = m_lookup.find(key);
+	if (it == m_lookup.end()) {
+		++m_num_misses;
+		return false;
+	}
+
+	// Move to front, since this is now the most recently used entry.
+	m_entries.splice(m_entries.begin(), m_entries, it->second);
+
+	out_path.assign(it->second->second.begin(), it->second->second.end());
+	++m_num_hits;
+	return true;
+}
+
+void NABE_PathCache::Put(const NABE_PathKey& key, const std::list<CNavArea*>& path)
+{
+	if (m_capacity == 0 || path.empty()) {
+		return;
+	}
+
+	auto it = m_lookup.find(key);
+	if (it != m_lookup.end()) {
+		it->second->second.assign(path.begin(), path.end());
+		m_entries.splice(m_entries.begin(), m_entries, it->second);
+		return;
+	}
+
+	// Evict the least recently used entry to make room.
+	if (m_entries.size() >= m_capacity) {
+		m_lookup.erase(m_entries.back().first);
+		m_entries.pop_back();
+	}
+
+	m_entries.emplace_front(key, std::vector<CNavArea*>(path.begin(), path.end()));
+	m_lookup[key] = m_entries.begin();
+}
+
+size_t NABE_PathCache::RemovePathsThrough(const std::unordered_set<const CNavArea*>& areas)
+{
+	size_t num_removed = 0;
+	for (auto it = m_entries.begin(); it != m_entries.end(); ) {
+		const auto& path = it->second;
+		if (std::any_of(path.begin(), path.end(), [&areas](const CNavArea* area) { return areas.count(area) != 0; })) {
+			m_lookup.erase(it->first);
+			it = m_entries.erase(it);
+			++num_removed;
+		}
+		else {
+			++it;
+		}
+	}
+	return num_removed;
+}
+
+void NABE_PathCache::Clear()
+{
+	m_entries.clear();
+	m_lookup.clear();
+}
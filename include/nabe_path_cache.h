@@ -0,0 +1,69 @@
+#ifndef NABENABE_PATH_CACHE_H
+#define NABENABE_PATH_CACHE_H
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+class CNavArea;
+
+// Purpose: Identifies a route by the nav areas it connects, rather than by the exact
+// world positions of a job. Any two positions resolving to the same pair of areas
+// produce the same route, so they can share a single solution.
+struct NABE_PathKey {
+	int area_id_from = 0;
+	int area_id_to = 0;
+
+	bool operator==(const NABE_PathKey& other) const
+	{
+		return area_id_from == other.area_id_from && area_id_to == other.area_id_to;
+	}
+};
+
+struct NABE_PathKeyHash {
+	size_t operator()(const NABE_PathKey& key) const
+	{
+		const auto h1 = std::hash<int>()(key.area_id_from);
+		const auto h2 = std::hash<int>()(key.area_id_to);
+		return h1 ^ (h2 + 0x9e3779b9 + (h1 << 6) + (h1 >> 2));
+	}
+};
+
+// Purpose: Least recently used cache of solved area-to-area routes for a single map.
+// A capacity of 0 disables the cache.
+class NABE_PathCache
+{
+public:
+	NABE_PathCache(size_t capacity = 0) : m_capacity(capacity)
+	{
+	}
+
+	// Returns true and copies the route into out_path on cache hit.
+	bool Get(const NABE_PathKey& key, std::list<CNavArea*>& out_path);
+	void Put(const NABE_PathKey& key, const std::list<CNavArea*>& path);
+	// Forget the routes passing through any of the areas. Returns the number of routes forgotten.
+	size_t RemovePathsThrough(const std::unordered_set<const CNavArea*>& areas);
+	void Clear();
+
+	size_t GetCapacity() const { return m_capacity; }
+	size_t GetSize() const { return m_entries.size(); }
+	size_t GetNumHits() const { return m_num_hits; }
+	size_t GetNumMisses() const { return m_num_misses; }
+
+private:
+	typedef std::pair<NABE_PathKey, std::vector<CNavArea*>> Entry;
+
+	// Most recently used entries are kept at the front.
+	std::list<Entry> m_entries;
+	std::unordered_map<NABE_PathKey, std::list<Entry>::iterator, NABE_PathKeyHash> m_lookup;
+
+	size_t m_capacity;
+	size_t m_num_hits = 0;
+	size_t m_num_misses = 0;
+};
+
+#endif // NABENABE_PATH_CACHE_H
@@ -4,6 +4,15 @@
 
 #include "nabe_nav_coordinator.h"
 #include "nabe_gamemap.h"
+#include "print_helpers.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <unordered_set>
 
 // The code in this file is based on the Source 1 SDK, and is used under the SOURCE 1 SDK LICENSE.
 // https://github.com/ValveSoftware/source-sdk-2013
@@ -113,10 +122,201 @@ bool NABE_PathFinder::AddMap(const NABE_GameMap* map)
 	if (!coordinator) {
 		return false;
 	}
+
+	if (m_first_move_table_max_areas != 0) {
+		LoadFirstMoveTable(coordinator, map->map_name);
+	}
+	if (m_num_landmarks != 0) {
+		BuildLandmarks(coordinator, map->map_name);
+	}
 	return true;
 }
 
-bool NABE_PathFinder::Solve(const std::string& map_name, int area_id_from, int area_id_to, std::list<CNavArea*>& out_path)
+NABE_DangerField& NABE_PathFinder::GetDangerField(NABE_NavCoordinator* coordinator, int layer)
+{
+	auto& danger = coordinator->m_danger[layer];
+	if (!danger.IsBuilt()) {
+		danger.Init(&coordinator->m_graph, m_danger_half_life_seconds, m_danger_decay_interval_ms);
+	}
+	return danger;
+}
+
+void NABE_PathFinder::BuildLandmarks(NABE_NavCoordinator* coordinator, const std::string& map_name)
+{
+	for (auto& route : m_landmark_routes) {
+		const auto start = std::chrono::steady_clock::now();
+		auto& landmarks = coordinator->m_landmarks[route];
+		if (!landmarks.Build(coordinator->m_graph, route, m_num_landmarks)) {
+			coordinator->m_landmarks.erase(route);
+			continue;
+		}
+		const auto build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		if (m_verbosity) {
+			print(Info, "%s: \"%s\": Built %zd landmarks for avoid %d, allow %d in %.0f ms: %.1f KiB",
+				__FUNCTION__, map_name.c_str(), landmarks.GetNumLandmarks(), route.avoid_attributes, route.allow_attributes,
+				build_ms, landmarks.GetMemoryUsage() / 1024.0);
+		}
+	}
+}
+
+void NABE_PathFinder::LoadFirstMoveTable(NABE_NavCoordinator* coordinator, const std::string& map_name)
+{
+	const auto& graph = coordinator->m_graph;
+	auto& table = coordinator->m_first_moves;
+	const auto num_areas = graph.GetNumAreas();
+	if (num_areas == 0 || num_areas > m_first_move_table_max_areas) {
+		if (m_verbosity) {
+			print(Info, "%s: \"%s\": Not using a first-move table for %zd areas (max %zd)",
+				__FUNCTION__, map_name.c_str(), num_areas, m_first_move_table_max_areas);
+		}
+		return;
+	}
+
+	const auto cache_path = m_nav_folder / fs::path(map_name + ".nabefm");
+	const auto build_start = std::chrono::steady_clock::now();
+	bool loaded = false;
+	if (m_first_move_table_cache) {
+		loaded = table.Load(cache_path, graph);
+	}
+	if (!loaded) {
+		if (!table.Build(graph, m_first_move_table_threads)) {
+			print(Warning, "%s: \"%s\": Some area has too many connections for a first-move table",
+				__FUNCTION__, map_name.c_str());
+			return;
+		}
+		if (m_first_move_table_cache && !table.Save(cache_path, graph)) {
+			print(Warning, "%s: Failed to write \"%s\"", __FUNCTION__, cache_path.string().c_str());
+		}
+	}
+	const auto build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - build_start).count();
+
+	// Compare against searching for the same random routes, to tell whether the table is worth its memory.
+	constexpr size_t num_samples = 1000;
+	std::minstd_rand rng(1234);
+	std::uniform_int_distribution<uint32_t> random_area(0, static_cast<uint32_t>(num_areas - 1));
+	std::vector<std::pair<uint32_t, uint32_t>> samples(num_samples);
+	for (auto& sample : samples) {
+		sample = { random_area(rng), random_area(rng) };
+	}
+
+	std::vector<uint32_t> path;
+	size_t total_path_areas = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (auto& sample : samples) {
+		table.GetPath(graph, sample.first, sample.second, path);
+		total_path_areas += path.size();
+	}
+	const auto table_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+	NABE_NavSearch search;
+	start = std::chrono::steady_clock::now();
+	for (auto& sample : samples) {
+		graph.FindPath(sample.first, sample.second, search, path);
+	}
+	const auto search_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+	print(Info, "%s: \"%s\": %s first-move table of %zd areas in %.0f ms: %zd runs, %.1f KiB (uncompressed %.1f KiB)",
+		__FUNCTION__, map_name.c_str(), (loaded ? "Loaded" : "Built"), num_areas, build_ms, table.GetNumRuns(),
+		table.GetMemoryUsage() / 1024.0, (num_areas * num_areas) / 1024.0);
+	print(Info, "%s: \"%s\": Average path of %.1f areas: %.2f us by table, %.2f us by search",
+		__FUNCTION__, map_name.c_str(), static_cast<double>(total_path_areas) / num_samples,
+		table_us / num_samples, search_us / num_samples);
+}
+
+bool NABE_PathFinder::HasMap(const std::string& map_name)
+{
+	return GetMapNavCoordinator(map_name, false) != nullptr;
+}
+
+void NABE_PathFinder::GetWaypoints(const std::list<CNavArea*>& path, std::vector<Vector>& out_waypoints)
+{
+	out_waypoints.clear();
+	out_waypoints.reserve(path.size());
+	for (auto& p : path) {
+		out_waypoints.push_back(p->GetCenter());
+	}
+}
+
+void NABE_PathFinder::GetWaypoints(const std::string& map_name, const Vector& pos_from, const Vector& pos_to,
+	const std::list<CNavArea*>& path, bool partial, std::vector<Vector>& out_waypoints)
+{
+	if (path.empty() || !m_smooth_paths ||
+		!SmoothPath(map_name, pos_from, partial ? path.back()->GetCenter() : pos_to, path, out_waypoints))
+	{
+		GetWaypoints(path, out_waypoints);
+	}
+
+	if (m_waypoint_tolerance > 0) {
+		SimplifyWaypoints(out_waypoints, m_waypoint_tolerance);
+	}
+}
+
+void NABE_PathFinder::SimplifyWaypoints(std::vector<Vector>& waypoints, float tolerance)
+{
+	if (waypoints.size() < 3) {
+		return;
+	}
+
+	// Squared distance from p to the 2D segment a -> b.
+	auto distance_sqr = [](const Vector& p, const Vector& a, const Vector& b) {
+		const float dx = b.x - a.x;
+		const float dy = b.y - a.y;
+		const float length_sqr = dx * dx + dy * dy;
+		float t = (length_sqr > 0.0f) ? ((p.x - a.x) * dx + (p.y - a.y) * dy) / length_sqr : 0.0f;
+		t = std::min(std::max(t, 0.0f), 1.0f);
+		const float ex = a.x + t * dx - p.x;
+		const float ey = a.y + t * dy - p.y;
+		return ex * ex + ey * ey;
+	};
+
+	// A waypoint is dropped if it, and every waypoint dropped since the last one kept, is within the tolerance
+	// of the straight line from the last one kept to the next one, all at the same height. Checking against
+	// the kept waypoint, rather than the dropped neighbour, keeps gentle curves from drifting away bit by bit.
+	const float tolerance_sqr = tolerance * tolerance;
+	size_t kept = 0;
+	size_t num_kept = 1;
+	for (size_t i = 1; i + 1 < waypoints.size(); ++i) {
+		const auto& from = waypoints[kept];
+		const auto& to = waypoints[i + 1];
+		bool redundant = (std::fabs(to.z - from.z) <= tolerance);
+		for (size_t j = kept + 1; redundant && j <= i; ++j) {
+			redundant = (std::fabs(waypoints[j].z - from.z) <= tolerance) &&
+				(distance_sqr(waypoints[j], from, to) <= tolerance_sqr);
+		}
+		if (!redundant) {
+			kept = i;
+			waypoints[num_kept++] = waypoints[i];
+		}
+	}
+	waypoints[num_kept++] = waypoints.back();
+	waypoints.resize(num_kept);
+}
+
+bool NABE_PathFinder::SmoothPath(const std::string& map_name, const Vector& start, const Vector& goal,
+	const std::list<CNavArea*>& path, std::vector<Vector>& out_waypoints)
+{
+	auto coordinator = GetMapNavCoordinator(map_name, false);
+	if (!coordinator) {
+		return false;
+	}
+
+	const auto& graph = coordinator->m_graph;
+	std::vector<uint32_t> indices;
+	indices.reserve(path.size());
+	for (auto& area : path) {
+		const auto index = graph.GetIndex(area->GetID());
+		if (index == NABE_NavGraph::INVALID_INDEX) {
+			return false;
+		}
+		indices.push_back(index);
+	}
+	graph.SmoothPath(indices, start, goal, out_waypoints);
+	return true;
+}
+
+bool NABE_PathFinder::Solve(const std::string& map_name, int area_id_from, int area_id_to, std::list<CNavArea*>& out_path, bool* out_partial,
+	const NABE_RouteOptions& route, bool check_cache)
 {
 	auto coordinator = GetMapNavCoordinator(map_name, false);
 	if (!coordinator) {
@@ -137,13 +337,301 @@ bool NABE_PathFinder::Solve(const std::string& map_name, int area_id_from, int a
 		return false;
 	}
 
-	CNavArea *from = area_from, *to = area_to, *next = nullptr;
+	return SolveAreas(coordinator, area_from, area_to, out_path, out_partial, route, check_cache);
+}
+
+bool NABE_PathFinder::Solve(const std::string& map_name, const Vector& pos_from, const Vector& pos_to, std::list<CNavArea*>& out_path, bool* out_partial,
+	const NABE_RouteOptions& route)
+{
+	auto coordinator = GetMapNavCoordinator(map_name, false);
+	if (!coordinator) {
+		return false;
+	}
+
+	auto area_from = coordinator->GetAreaByPos(pos_from);
+	auto area_to = coordinator->GetAreaByPos(pos_to);
+
+	if (!area_from) {
+		print(Error, "%s: Failed to find pos_from (%f %f %f) for \"%s\"",
+			__FUNCTION__, pos_from.x, pos_from.y, pos_from.z, map_name.c_str());
+		return false;
+	}
+	else if (!area_to) {
+		print(Error, "%s: Failed to find pos_to (%f %f %f) for \"%s\"",
+			__FUNCTION__, pos_to.x, pos_to.y, pos_to.z, map_name.c_str());
+		return false;
+	}
+
+	return SolveAreas(coordinator, area_from, area_to, out_path, out_partial, route);
+}
+
+size_t NABE_PathFinder::SolveMany(const std::string& map_name, int area_id_from, const std::vector<int>& area_ids_to,
+	std::vector<std::list<CNavArea*>>& out_paths, const NABE_RouteOptions& route, bool check_cache)
+{
+	out_paths.assign(area_ids_to.size(), {});
+
+	auto coordinator = GetMapNavCoordinator(map_name, false);
+	if (!coordinator) {
+		return 0;
+	}
+
+	auto from = coordinator->GetAreaById(area_id_from);
+	if (!from) {
+		print(Error, "%s: Failed to find area_id_from %d for \"%s\"", __FUNCTION__, area_id_from, map_name.c_str());
+		return 0;
+	}
+
+	// The safest and team aware routes don't search the graph, and the first-move tables need no search at all,
+	// so those are solved one by one.
+	const bool use_precomputed = route.IsDefault();
+	const bool share_search = !route.safest && !route.IsTeamAware() && !(use_precomputed && coordinator->m_first_moves.IsBuilt());
+
+	const auto& graph = coordinator->m_graph;
+	const auto from_index = graph.GetIndex(area_id_from);
+	size_t num_found = 0;
+
+	// Goals left for the shared search, and the paths they're for.
+	std::vector<uint32_t> goals;
+	std::vector<size_t> goal_paths;
+	for (size_t i = 0; i < area_ids_to.size(); ++i) {
+		auto to = coordinator->GetAreaById(area_ids_to[i]);
+		if (!to) {
+			print(Error, "%s: Failed to find area_id_to %d for \"%s\"", __FUNCTION__, area_ids_to[i], map_name.c_str());
+			continue;
+		}
+
+		if (!share_search) {
+			if (SolveAreas(coordinator, from, to, out_paths[i], nullptr, route, check_cache)) {
+				++num_found;
+			}
+			continue;
+		}
+
+		const auto to_index = graph.GetIndex(area_ids_to[i]);
+		if (use_precomputed) {
+			std::vector<uint32_t> tree_path;
+			if (check_cache && coordinator->m_path_cache.Get(NABE_PathKey{ area_id_from, area_ids_to[i] }, out_paths[i])) {
+				++num_found;
+				continue;
+			}
+			if (coordinator->m_goal_trees.GetPath(graph, from_index, to_index, tree_path)) {
+				graph.GetPath(tree_path, out_paths[i]);
+				if (!tree_path.empty()) {
+					++num_found;
+				}
+				continue;
+			}
+		}
+
+		if (coordinator->m_components.MayReach(from_index, to_index)) {
+			goals.push_back(to_index);
+			goal_paths.push_back(i);
+		}
+	}
+
+	if (goals.empty()) {
+		return num_found;
+	}
+
+	if (m_verbosity) {
+		print(Info, "Solving %zd paths from area %d at once", goals.size(), area_id_from);
+	}
+
+	// The shared search stands in for a search per goal, so it gets all of their budgets together.
+	NABE_SearchBudget budget;
+	budget.max_expansions = m_max_search_expansions * goals.size();
+	budget.max_microseconds = m_max_search_microseconds * static_cast<long long>(goals.size());
+	std::vector<std::vector<uint32_t>> paths;
+	graph.FindPaths(from_index, goals, route, coordinator->m_search, paths, &budget);
+	if (budget.exhausted) {
+		print(Warning, "%s: Search from area %d to %zd areas ran out of budget.", __FUNCTION__, area_id_from, goals.size());
+	}
+	for (size_t i = 0; i < goals.size(); ++i) {
+		if (paths[i].empty()) {
+			continue;
+		}
+		auto& out_path = out_paths[goal_paths[i]];
+		graph.GetPath(paths[i], out_path);
+		++num_found;
+		if (use_precomputed) {
+			coordinator->m_path_cache.Put(NABE_PathKey{ area_id_from, area_ids_to[goal_paths[i]] }, out_path);
+		}
+	}
+	return num_found;
+}
+
+// Purpose: Cost policy of NavAreaBuildPath with the lengths of the graph's edges, for the cost models other than
+// NABE_EdgeCostModel::Centers (which FastestRouteCost computes directly).
+struct GraphRouteCost
+{
+	const NABE_NavGraph& graph;
+	int allowAttributes = 0;
+
+	float operator()(CNavArea* area, CNavArea* fromArea) const
+	{
+		if (fromArea == nullptr) {
+			return 0.0f;
+		}
+
+		// Only a scan of the few edges of the area we came from.
+		const auto edge = graph.FindEdge(NABE_NavGraph::GetIndex(fromArea), NABE_NavGraph::GetIndex(area));
+		const float length = (edge != NABE_NavGraph::INVALID_INDEX) ?
+			graph.GetEdgeLength(edge) : (area->GetCenter() - fromArea->GetCenter()).Length();
+		return fromArea->GetCostSoFar() + NABE_NavGraph::GetTravelCost(length, area->GetAttributes() & ~allowAttributes);
+	}
+};
+
+// Search with the cost, never entering the route's avoided areas.
+template <typename Cost>
+static bool SearchPathAvoiding(CNavArea* from, CNavArea* to, const Cost& cost, const NABE_RouteOptions& route,
+	std::list<CNavArea*>& out_path, CNavArea** closest_area, NavSearchBudget* budget)
+{
+	if (route.avoid_attributes != 0) {
+		const AvoidAttributesCost<Cost> avoid{ cost, route.avoid_attributes };
+		return NavAreaBuildPath(from, to, nullptr, avoid, DistanceHeuristic(), out_path, closest_area, budget);
+	}
+	return NavAreaBuildPath(from, to, nullptr, cost, DistanceHeuristic(), out_path, closest_area, budget);
+}
+
+// Search with the cost, weighted by the enemy team's presence if the route is team aware.
+template <typename Cost>
+static bool SearchPathForTeam(CNavArea* from, CNavArea* to, const Cost& cost, const NABE_RouteOptions& route,
+	const NABE_NavTeams& teams, std::list<CNavArea*>& out_path, CNavArea** closest_area, NavSearchBudget* budget)
+{
+	if (route.IsTeamAware()) {
+		const EnemyOccupyCost<Cost, NABE_NavTeams> enemy{ cost, teams, NABE_NavTeams::GetEnemyTeam(route.team),
+			static_cast<float>(route.round_time), route.seek_enemy };
+		return SearchPathAvoiding(from, to, enemy, route, out_path, closest_area, budget);
+	}
+	return SearchPathAvoiding(from, to, cost, route, out_path, closest_area, budget);
+}
+
+// Pick the search for the route options, once per query.
+static bool SearchPath(CNavArea* from, CNavArea* to, const NABE_RouteOptions& route, const NABE_NavGraph& graph,
+	const NABE_DangerField& danger, const NABE_NavTeams& teams, std::list<CNavArea*>& out_path, CNavArea** closest_area,
+	NavSearchBudget* budget)
+{
+	if (route.safest) {
+		SafestRouteCost<NABE_DangerField> safest{ danger, route.team };
+		safest.allowAttributes = route.allow_attributes;
+		return SearchPathForTeam(from, to, safest, route, teams, out_path, closest_area, budget);
+	}
+
+	if (graph.GetCostModel() != NABE_EdgeCostModel::Centers) {
+		const GraphRouteCost fastest{ graph, route.allow_attributes };
+		return SearchPathForTeam(from, to, fastest, route, teams, out_path, closest_area, budget);
+	}
+
+	const FastestRouteCost fastest{ route.allow_attributes };
+	return SearchPathForTeam(from, to, fastest, route, teams, out_path, closest_area, budget);
+}
+
+bool NABE_PathFinder::SolveAreas(NABE_NavCoordinator* coordinator, CNavArea* from, CNavArea* to, std::list<CNavArea*>& out_path,
+	bool* out_partial, const NABE_RouteOptions& route, bool check_cache)
+{
+	const bool want_partial = (out_partial && m_partial_paths);
+	if (out_partial) {
+		*out_partial = false;
+	}
+
+	// The precomputed data is only for the default options.
+	const bool use_precomputed = route.IsDefault();
+
+	const NABE_PathKey key{ static_cast<int>(from->GetID()), static_cast<int>(to->GetID()) };
+	if (use_precomputed && check_cache && coordinator->m_path_cache.Get(key, out_path)) {
+		if (m_verbosity) {
+			print(Info, "Cached path: area %d --> area %d", from->GetID(), to->GetID());
+		}
+		return true;
+	}
 
 	if (m_verbosity) {
 		print(Info, "Solving path: area %d --> area %d", from->GetID(), to->GetID());
 	}
 
-	const bool success = NavAreaBuildPath(from, to, nullptr, out_path);
+	const auto& graph = coordinator->m_graph;
+	const bool may_reach = coordinator->m_components.MayReach(graph.GetIndex(from->GetID()), graph.GetIndex(to->GetID()));
+	if (!may_reach && !want_partial) {
+		if (m_verbosity) {
+			print(Warning, "%s: Area %d can't be reached from area %d.", __FUNCTION__, to->GetID(), from->GetID());
+		}
+		return false;
+	}
+
+	bool success = false;
+	// Whether a first-move table, shortest path tree or graph search had the answer, so there's no need for NavAreaBuildPath.
+	bool answered = false;
+	std::vector<uint32_t> tree_path;
+	if (use_precomputed && may_reach && coordinator->m_first_moves.IsBuilt()) {
+		success = coordinator->m_first_moves.GetPath(graph, graph.GetIndex(from->GetID()), graph.GetIndex(to->GetID()), tree_path);
+		graph.GetPath(tree_path, out_path);
+		answered = true;
+	}
+	else if (use_precomputed && may_reach && coordinator->m_goal_trees.GetPath(graph, graph.GetIndex(from->GetID()), graph.GetIndex(to->GetID()), tree_path)) {
+		if (m_verbosity) {
+			print(Info, "Following shortest path tree of area %d", to->GetID());
+		}
+		graph.GetPath(tree_path, out_path);
+		success = !tree_path.empty();
+		answered = true;
+	}
+	else if (!use_precomputed && !route.safest && !route.IsTeamAware()) {
+		// The flat graph filters the edges by their attributes directly, and has the landmarks of the common options.
+		NABE_RouteOptions masks;
+		masks.avoid_attributes = route.avoid_attributes;
+		masks.allow_attributes = route.allow_attributes;
+		auto landmarks = coordinator->m_landmarks.find(masks);
+		NABE_SearchBudget budget;
+		budget.max_expansions = m_max_search_expansions;
+		budget.max_microseconds = m_max_search_microseconds;
+		uint32_t closest = NABE_NavGraph::INVALID_INDEX;
+		success = graph.FindPath(graph.GetIndex(from->GetID()), graph.GetIndex(to->GetID()), route, coordinator->m_search, tree_path,
+			(landmarks == coordinator->m_landmarks.end()) ? nullptr : &landmarks->second, &budget, &closest);
+
+		if (budget.exhausted) {
+			print(Warning, "%s: Search from area %d to area %d ran out of budget.", __FUNCTION__, from->GetID(), to->GetID());
+		}
+
+		if (!success && want_partial && closest != NABE_NavGraph::INVALID_INDEX) {
+			graph.GetSearchPath(coordinator->m_search, closest, tree_path);
+			*out_partial = true;
+			success = true;
+		}
+		graph.GetPath(tree_path, out_path);
+		answered = true;
+	}
+
+	// Without a full path, only a search can tell how close to the goal we can get.
+	if (!answered || (!success && want_partial)) {
+		CNavArea* closest_area = nullptr;
+		NavSearchBudget budget;
+		budget.maxExpansions = m_max_search_expansions;
+		budget.maxMicroseconds = m_max_search_microseconds;
+		auto& danger = GetDangerField(coordinator, route.danger_layer);
+		if (route.safest) {
+			danger.Update(std::chrono::steady_clock::now());
+		}
+		success = SearchPath(from, to, route, graph, danger, coordinator->m_teams, out_path, &closest_area, &budget);
+
+		if (budget.exhausted) {
+			print(Warning, "%s: Search from area %d to area %d ran out of budget.", __FUNCTION__, from->GetID(), to->GetID());
+		}
+
+		// The parents of the search lead back from the closest area to the start.
+		if (!success && want_partial && closest_area) {
+			out_path.clear();
+			for (auto area = closest_area; area && out_path.size() <= graph.GetNumAreas(); area = area->GetParent()) {
+				out_path.push_front(area);
+			}
+			*out_partial = true;
+			success = true;
+		}
+	}
+
+	// Partial paths are not cached, so that the next request gets another chance at the full path.
+	if (success && use_precomputed && !(out_partial && *out_partial)) {
+		coordinator->m_path_cache.Put(key, out_path);
+	}
 
 	if (m_verbosity) {
 		if (!success) {
@@ -168,7 +656,8 @@ bool NABE_PathFinder::Solve(const std::string& map_name, int area_id_from, int a
 	return success;
 }
 
-bool NABE_PathFinder::Solve(const std::string& map_name, const Vector& pos_from, const Vector& pos_to, std::list<CNavArea*>& out_path)
+bool NABE_PathFinder::ResolveAreas(const std::string& map_name, const Vector& pos_from, const Vector& pos_to,
+	int& out_area_id_from, int& out_area_id_to)
 {
 	auto coordinator = GetMapNavCoordinator(map_name, false);
 	if (!coordinator) {
@@ -177,44 +666,259 @@ bool NABE_PathFinder::Solve(const std::string& map_name, const Vector& pos_from,
 
 	auto area_from = coordinator->GetAreaByPos(pos_from);
 	auto area_to = coordinator->GetAreaByPos(pos_to);
+	if (!area_from || !area_to) {
+		return false;
+	}
 
-	if (!area_from) {
-		print(Error, "%s: Failed to find pos_from (%f %f %f) for \"%s\"",
-			__FUNCTION__, pos_from.x, pos_from.y, pos_from.z, map_name.c_str());
+	out_area_id_from = area_from->GetID();
+	out_area_id_to = area_to->GetID();
+	return true;
+}
+
+bool NABE_PathFinder::ResolveArea(const std::string& map_name, const Vector& pos, int& out_area_id)
+{
+	auto coordinator = GetMapNavCoordinator(map_name, false);
+	if (!coordinator) {
 		return false;
 	}
-	else if (!area_to) {
-		print(Error, "%s: Failed to find pos_to (%f %f %f) for \"%s\"",
-			__FUNCTION__, pos_to.x, pos_to.y, pos_to.z, map_name.c_str());
+
+	auto area = coordinator->GetAreaByPos(pos);
+	if (!area) {
 		return false;
 	}
 
-	CNavArea* from = area_from, * to = area_to, * next = nullptr;
+	out_area_id = area->GetID();
+	return true;
+}
 
-	if (m_verbosity) {
-		print(Info, "Solving path: area %d --> area %d", from->GetID(), to->GetID());
+bool NABE_PathFinder::GetAreaCenters(const std::string& map_name, std::vector<Vector>& out_centers)
+{
+	out_centers.clear();
+
+	auto coordinator = GetMapNavCoordinator(map_name, false);
+	if (!coordinator) {
+		return false;
+	}
+
+	const auto& graph = coordinator->m_graph;
+	out_centers.reserve(graph.GetNumAreas());
+	for (uint32_t i = 0; i < graph.GetNumAreas(); ++i) {
+		out_centers.push_back(graph.GetCenter(i));
+	}
+	return !out_centers.empty();
+}
+
+bool NABE_PathFinder::GetCachedPath(const std::string& map_name, int area_id_from, int area_id_to, std::list<CNavArea*>& out_path)
+{
+	auto coordinator = GetMapNavCoordinator(map_name, false);
+	if (!coordinator) {
+		return false;
+	}
+	return coordinator->m_path_cache.Get({ area_id_from, area_id_to }, out_path);
+}
+
+void NABE_PathFinder::CachePath(const std::string& map_name, int area_id_from, int area_id_to, const std::list<CNavArea*>& path)
+{
+	auto coordinator = GetMapNavCoordinator(map_name, false);
+	if (coordinator) {
+		coordinator->m_path_cache.Put({ area_id_from, area_id_to }, path);
+	}
+}
+
+void NABE_PathFinder::InvalidatePaths(const std::string& map_name)
+{
+	auto coordinator = GetMapNavCoordinator(map_name, false);
+	if (coordinator) {
+		coordinator->m_path_cache.Clear();
+		coordinator->m_goal_trees.Clear();
+		coordinator->m_first_moves.Clear();
+	}
+}
+
+size_t NABE_PathFinder::SetAreasBlocked(const std::string& map_name, const std::vector<std::pair<int, bool>>& area_states)
+{
+	auto coordinator = GetMapNavCoordinator(map_name, false);
+	if (!coordinator) {
+		return 0;
+	}
+
+	std::vector<int> changed_area_ids;
+	for (auto& state : area_states) {
+		auto area = coordinator->GetAreaById(state.first);
+		if (!area) {
+			print(Warning, "%s: No area %d in \"%s\"", __FUNCTION__, state.first, map_name.c_str());
+			continue;
+		}
+		if (area->IsBlocked() != state.second) {
+			area->SetBlocked(state.second);
+			changed_area_ids.push_back(state.first);
+		}
+	}
+
+	if (!changed_area_ids.empty()) {
+		OnBlockedAreasChanged(map_name, changed_area_ids);
+	}
+	return changed_area_ids.size();
+}
+
+void NABE_PathFinder::OnBlockedAreasChanged(const std::string& map_name, const std::vector<int>& area_ids)
+{
+	auto coordinator = GetMapNavCoordinator(map_name, false);
+	if (!coordinator) {
+		return;
+	}
+
+	const auto& graph = coordinator->m_graph;
+	std::vector<uint32_t> indices;
+	std::unordered_set<const CNavArea*> blocked_areas;
+	bool any_unblocked = false;
+	for (auto& id : area_ids) {
+		const auto index = graph.GetIndex(id);
+		if (index == NABE_NavGraph::INVALID_INDEX) {
+			continue;
+		}
+		indices.push_back(index);
+		if (graph.IsBlocked(index)) {
+			blocked_areas.insert(graph.GetArea(index));
+		}
+		else {
+			any_unblocked = true;
+		}
+	}
+
+	coordinator->m_components.Update(graph, indices);
+	coordinator->m_goal_trees.Repair(graph, indices);
+	// Not worth rebuilding for temporary changes, so the map falls back to searching.
+	coordinator->m_first_moves.Clear();
+
+	// Paths through a newly blocked area are no longer walkable, but the rest still are.
+	// A newly unblocked area may make any of them shorter though.
+	size_t num_removed;
+	if (any_unblocked) {
+		num_removed = coordinator->m_path_cache.GetSize();
+		coordinator->m_path_cache.Clear();
+	}
+	else {
+		num_removed = coordinator->m_path_cache.RemovePathsThrough(blocked_areas);
 	}
-	
-	const bool success = NavAreaBuildPath(from, to, nullptr, out_path);
 
 	if (m_verbosity) {
-		if (!success) {
-			print(Warning, "%s: Failed to solve path.", __FUNCTION__);
+		print(Info, "%s: \"%s\": %zd areas changed, forgot %zd cached paths, repaired %zd shortest path trees.",
+			__FUNCTION__, map_name.c_str(), indices.size(), num_removed, coordinator->m_goal_trees.GetSize());
+	}
+}
+
+size_t NABE_PathFinder::AddDanger(const std::string& map_name, int layer, const std::vector<NABE_DangerEvent>& events)
+{
+	auto coordinator = GetMapNavCoordinator(map_name, false);
+	if (!coordinator) {
+		return 0;
+	}
+
+	// Decay first, so that the new danger starts out at full strength.
+	auto& danger = GetDangerField(coordinator, layer);
+	danger.Update(std::chrono::steady_clock::now());
+
+	size_t num_applied = 0;
+	for (auto& event : events) {
+		if (danger.IncreaseDanger(coordinator->m_graph.GetIndex(event.area_id), event.team, event.amount)) {
+			++num_applied;
 		}
 		else {
-			print(Info, "%s: Found solution (this route visits %d areas total):", __FUNCTION__, out_path.size());
-			size_t num = 0;
-			constexpr auto print_full_path = false;
-			if (print_full_path) {
-				for (auto& p : out_path) {
-					print(Info, "\t * Path node %d: go through area %d\t(world XYZ coordinates: %.2f %.2f %.2f)",
-						num++,
-						p->GetID(),
-						p->GetCenter().x, p->GetCenter().y, p->GetCenter().z);
-				}
-			}
+			print(Warning, "%s: Invalid danger event for \"%s\": area %d, team %d", __FUNCTION__, map_name.c_str(),
+				event.area_id, event.team);
 		}
 	}
+	return num_applied;
+}
 
-	return success;
+bool NABE_PathFinder::GetPathFromAreaIds(const std::string& map_name, const std::vector<int>& area_ids, std::list<CNavArea*>& out_path)
+{
+	auto coordinator = GetMapNavCoordinator(map_name, false);
+	if (!coordinator) {
+		return false;
+	}
+
+	std::list<CNavArea*> path;
+	for (auto& id : area_ids) {
+		auto area = coordinator->GetAreaById(id);
+		if (!area || area->IsBlocked()) {
+			return false;
+		}
+		path.push_back(area);
+	}
+	out_path.splice(out_path.end(), path);
+	return true;
+}
+
+size_t NABE_PathFinder::Precompute(const std::string& map_name, const std::vector<int>& area_ids, size_t num_threads)
+{
+	auto coordinator = GetMapNavCoordinator(map_name, false);
+	if (!coordinator) {
+		return 0;
+	}
+	const auto& graph = coordinator->m_graph;
+	const auto& components = coordinator->m_components;
+
+	std::vector<uint32_t> indices;
+	for (auto& id : area_ids) {
+		const auto index = graph.GetIndex(id);
+		if (index == NABE_NavGraph::INVALID_INDEX) {
+			print(Warning, "%s: No area %d in \"%s\"", __FUNCTION__, id, map_name.c_str());
+			continue;
+		}
+		indices.push_back(index);
+	}
+	std::sort(indices.begin(), indices.end());
+	indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+
+	const size_t num_pairs = indices.size() * indices.size();
+	if (num_pairs == 0) {
+		return 0;
+	}
+	if (num_pairs > m_path_cache_size) {
+		print(Warning, "%s: \"%s\": %zd paths won't fit in the path cache of %zd paths.",
+			__FUNCTION__, map_name.c_str(), num_pairs, m_path_cache_size);
+	}
+
+	// The graph is read-only, so the threads only need their own search state and result slots.
+	std::vector<std::vector<uint32_t>> paths(num_pairs);
+	std::vector<char> found(num_pairs, 0);
+	std::atomic<size_t> next_pair{ 0 };
+	auto worker = [&]() {
+		NABE_NavSearch search;
+		for (auto i = next_pair++; i < num_pairs; i = next_pair++) {
+			const auto from = indices[i / indices.size()];
+			const auto to = indices[i % indices.size()];
+			found[i] = components.MayReach(from, to) && graph.FindPath(from, to, search, paths[i]);
+		}
+	};
+
+	num_threads = std::max<size_t>(1, std::min(num_threads, num_pairs));
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < num_threads; ++i) {
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	size_t num_found = 0;
+	std::list<CNavArea*> path;
+	for (size_t i = 0; i < num_pairs; ++i) {
+		if (!found[i]) {
+			continue;
+		}
+		path.clear();
+		graph.GetPath(paths[i], path);
+		coordinator->m_path_cache.Put({ static_cast<int>(path.front()->GetID()), static_cast<int>(path.back()->GetID()) }, path);
+		++num_found;
+	}
+
+	if (m_verbosity) {
+		print(Info, "%s: \"%s\": Found %zd paths between %zd areas, using %zd threads.",
+			__FUNCTION__, map_name.c_str(), num_found, indices.size(), num_threads);
+	}
+	return num_found;
 }
@@ -3,11 +3,15 @@
 
 #include "thirdparty/source-sdk-stubs/nav_area.h"
 
+#include "nabe_danger_field.h"
 #include "nabe_filesystem.h"
+#include "nabe_nav_graph.h"
+#include "nabe_route_options.h"
 
 #include <vector>
 #include <string>
 #include <list>
+#include <utility>
 
 // The code in this file is based on the Source 1 SDK, and is used under the SOURCE 1 SDK LICENSE.
 // https://github.com/ValveSoftware/source-sdk-2013
@@ -86,8 +90,141 @@ public:
 	}
 
 	bool AddMap(const NABE_GameMap* map);
-	bool Solve(const std::string& map_name, int area_id_from, int area_id_to, std::list<CNavArea*>& out_path);
-	bool Solve(const std::string& map_name, const Vector& pos_from, const Vector& pos_to, std::list<CNavArea*>& out_path);
+	bool HasMap(const std::string& map_name);
+	// If out_partial is given, a search that runs out of budget or finds no path still succeeds,
+	// with the path towards the area closest to the goal, and *out_partial set (see SetSearchBudget).
+	// Without check_cache, the path cache is left to the caller, who already missed it (see GetCachedPath),
+	// so that the miss isn't counted twice. The solved path is still added to it.
+	bool Solve(const std::string& map_name, int area_id_from, int area_id_to, std::list<CNavArea*>& out_path,
+		bool* out_partial = nullptr, const NABE_RouteOptions& route = NABE_RouteOptions(), bool check_cache = true);
+	bool Solve(const std::string& map_name, const Vector& pos_from, const Vector& pos_to, std::list<CNavArea*>& out_path,
+		bool* out_partial = nullptr, const NABE_RouteOptions& route = NABE_RouteOptions());
+
+	// Solve the paths from one area to several, sharing a single search (see NABE_NavGraph::FindPaths) for the goals
+	// that aren't cached. out_paths receives a path per goal, in order, left empty where there's no path.
+	// Never gives partial paths. The shared search gets the search budget of all of its goals together.
+	// check_cache is the same as for Solve. Returns the number of paths found.
+	size_t SolveMany(const std::string& map_name, int area_id_from, const std::vector<int>& area_ids_to,
+		std::vector<std::list<CNavArea*>>& out_paths, const NABE_RouteOptions& route = NABE_RouteOptions(),
+		bool check_cache = true);
+
+	// Resolve the world positions of a job into the ids of the nav areas they belong to.
+	bool ResolveAreas(const std::string& map_name, const Vector& pos_from, const Vector& pos_to,
+		int& out_area_id_from, int& out_area_id_to);
+
+	// Resolve a world position into the id of the nav area it belongs to.
+	bool ResolveArea(const std::string& map_name, const Vector& pos, int& out_area_id);
+
+	// The centers of all of a map's nav areas, eg. for generating test jobs.
+	bool GetAreaCenters(const std::string& map_name, std::vector<Vector>& out_centers);
+
+	// Area-keyed solution cache access. These never run a search.
+	bool GetCachedPath(const std::string& map_name, int area_id_from, int area_id_to, std::list<CNavArea*>& out_path);
+	void CachePath(const std::string& map_name, int area_id_from, int area_id_to, const std::list<CNavArea*>& path);
+
+	// Solve the paths between every ordered pair of the given areas, spread over num_threads threads,
+	// and add them to the path cache. Returns the number of paths found.
+	size_t Precompute(const std::string& map_name, const std::vector<int>& area_ids, size_t num_threads);
+
+	// Forget all of the cached paths, shortest path trees and first-move table of a map.
+	void InvalidatePaths(const std::string& map_name);
+
+	// Block or unblock areas of a map (eg. doors and obstacles reported by the game server), as a single batch.
+	// Only areas whose state actually changes are updated. Returns the number of such areas.
+	size_t SetAreasBlocked(const std::string& map_name, const std::vector<std::pair<int, bool>>& area_states);
+
+	// Must be called after changing the blocked state of some of a map's areas, to update the connectivity
+	// of the map, repair its shortest path trees, and forget the cached paths that may no longer be valid.
+	void OnBlockedAreasChanged(const std::string& map_name, const std::vector<int>& area_ids);
+
+	// A new layer of danger, for a job source that reports the danger of its own game server (eg. a database),
+	// so that its safest routes aren't swayed by the others'. Layer 0 is never reported to, and has no danger.
+	int AddDangerLayer() { return ++m_num_danger_layers; }
+
+	// Add reported danger (eg. kills) to the areas of a map, for the safest routes of the layer (see
+	// NABE_RouteOptions::danger_layer). Returns the number of events applied.
+	size_t AddDanger(const std::string& map_name, int layer, const std::vector<NABE_DangerEvent>& events);
+
+	// Convert a list of area ids (eg. from a stored solution) into a path. Fails if any of the areas don't exist,
+	// or are blocked (see SetAreasBlocked), so that a stored path through a door closed since is solved again.
+	bool GetPathFromAreaIds(const std::string& map_name, const std::vector<int>& area_ids, std::list<CNavArea*>& out_path);
+
+	// The world positions a bot should walk through to follow the path, in order.
+	static void GetWaypoints(const std::list<CNavArea*>& path, std::vector<Vector>& out_waypoints);
+	// Same, for a job from pos_from to pos_to. If smoothing is enabled (see SetSmoothPaths), the path is pulled taut
+	// through the portals between its areas, leaving only the corners; it ends at the last area if the path is partial.
+	// Redundant waypoints are then dropped, as set by SetWaypointTolerance.
+	void GetWaypoints(const std::string& map_name, const Vector& pos_from, const Vector& pos_to,
+		const std::list<CNavArea*>& path, bool partial, std::vector<Vector>& out_waypoints);
+
+	// Drop the waypoints that are within tolerance units of the straight line between their neighbours,
+	// at the same height (also within tolerance). The first and last waypoints are always kept.
+	static void SimplifyWaypoints(std::vector<Vector>& waypoints, float tolerance);
+
+	// Max number of area-to-area routes to keep cached in memory per map. Zero disables the cache.
+	// Must be set before adding any maps.
+	void SetPathCacheSize(size_t size) { m_path_cache_size = size; }
+	size_t GetPathCacheSize() const { return m_path_cache_size; }
+
+	// Max number of shortest path trees to keep per map, for the goals requested at least min_requests times.
+	// Zero disables the trees. Must be set before adding any maps.
+	void SetGoalTreeCacheSize(size_t size, size_t min_requests)
+	{
+		m_goal_tree_cache_size = size;
+		m_goal_tree_min_requests = min_requests;
+	}
+	size_t GetGoalTreeCacheSize() const { return m_goal_tree_cache_size; }
+	size_t GetGoalTreeMinRequests() const { return m_goal_tree_min_requests; }
+
+	// Limits of a single search, so that a pathological query can't hold up the rest of the batch.
+	// Zero means no limit. If partial_paths, searches that give up return their best partial path instead,
+	// as do searches that find no path at all.
+	void SetSearchBudget(size_t max_expansions, long long max_microseconds, bool partial_paths)
+	{
+		m_max_search_expansions = max_expansions;
+		m_max_search_microseconds = max_microseconds;
+		m_partial_paths = partial_paths;
+	}
+	bool GetPartialPaths() const { return m_partial_paths; }
+
+	// Build a first-move table (see NABE_FirstMoveTable) for the maps with at most max_areas nav areas,
+	// spread over num_threads threads. Zero disables the tables. If use_cache_file, the tables are stored
+	// next to the map's .nav, and loaded from there if still up to date. Must be set before adding any maps.
+	void SetFirstMoveTables(size_t max_areas, size_t num_threads, bool use_cache_file)
+	{
+		m_first_move_table_max_areas = max_areas;
+		m_first_move_table_threads = num_threads;
+		m_first_move_table_cache = use_cache_file;
+	}
+
+	// How fast the danger of the areas fades: it halves every half_life_seconds, applied every decay_interval_ms at most.
+	// Must be set before adding any maps.
+	void SetDangerDecay(float half_life_seconds, size_t decay_interval_ms)
+	{
+		m_danger_half_life_seconds = half_life_seconds;
+		m_danger_decay_interval_ms = decay_interval_ms;
+	}
+	float GetDangerHalfLife() const { return m_danger_half_life_seconds; }
+
+	// Build landmarks (see NABE_Landmarks) for each of the route options, to speed up their searches.
+	// Meant for the most common options of the jobs; options without landmarks still search, just slower.
+	// Zero num_landmarks disables them. Must be set before adding any maps.
+	void SetLandmarks(const std::vector<NABE_RouteOptions>& routes, size_t num_landmarks)
+	{
+		m_landmark_routes = routes;
+		m_num_landmarks = num_landmarks;
+	}
+
+	// How the cost of moving between two areas is measured (see NABE_EdgeCostModel). The safest routes always
+	// measure from center to center. Must be set before adding any maps.
+	void SetEdgeCostModel(NABE_EdgeCostModel cost_model) { m_edge_cost_model = cost_model; }
+	NABE_EdgeCostModel GetEdgeCostModel() const { return m_edge_cost_model; }
+
+	void SetSmoothPaths(bool smooth) { m_smooth_paths = smooth; }
+	bool GetSmoothPaths() const { return m_smooth_paths; }
+
+	// See SimplifyWaypoints. Zero keeps every waypoint.
+	void SetWaypointTolerance(float tolerance) { m_waypoint_tolerance = tolerance; }
 
 	const fs::path& GetMapFolderPath() const { return m_map_folder; }
 	const fs::path& GetNavFolderPath() const { return m_nav_folder; }
@@ -96,10 +233,42 @@ private:
 	NABE_NavCoordinator* GetMapNavCoordinator(const std::string& map_name, const bool build_if_not_exists);
 	NABE_NavCoordinator* BuildMapNavCoordinator(const std::string& map_name);
 
+	// Load or build the map's first-move table, and report what it costs.
+	void LoadFirstMoveTable(NABE_NavCoordinator* coordinator, const std::string& map_name);
+
+	void BuildLandmarks(NABE_NavCoordinator* coordinator, const std::string& map_name);
+
+	// The danger of a layer of the map, created on first use.
+	NABE_DangerField& GetDangerField(NABE_NavCoordinator* coordinator, int layer);
+
+	bool SolveAreas(NABE_NavCoordinator* coordinator, CNavArea* from, CNavArea* to, std::list<CNavArea*>& out_path,
+		bool* out_partial, const NABE_RouteOptions& route, bool check_cache = true);
+
+	// Pull the path taut through the portals of the map's nav graph. Fails if the map or any of the areas is unknown.
+	bool SmoothPath(const std::string& map_name, const Vector& start, const Vector& goal, const std::list<CNavArea*>& path,
+		std::vector<Vector>& out_waypoints);
+
 private:
 	fs::path m_map_folder;
 	fs::path m_nav_folder;
 	std::vector<NABE_NavCoordinator*> m_coordinators;
+	size_t m_path_cache_size = 0;
+	size_t m_goal_tree_cache_size = 0;
+	size_t m_goal_tree_min_requests = 1;
+	size_t m_max_search_expansions = 0;
+	long long m_max_search_microseconds = 0;
+	bool m_partial_paths = false;
+	size_t m_first_move_table_max_areas = 0;
+	size_t m_first_move_table_threads = 1;
+	bool m_first_move_table_cache = true;
+	std::vector<NABE_RouteOptions> m_landmark_routes;
+	size_t m_num_landmarks = 0;
+	float m_danger_half_life_seconds = 0;
+	size_t m_danger_decay_interval_ms = 0;
+	int m_num_danger_layers = 0;
+	NABE_EdgeCostModel m_edge_cost_model = NABE_EdgeCostModel::Centers;
+	bool m_smooth_paths = false;
+	float m_waypoint_tolerance = 0;
 	bool m_verbosity;
 };
 
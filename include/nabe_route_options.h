@@ -0,0 +1,37 @@
+#ifndef NABENABE_ROUTE_OPTIONS_H
+#define NABENABE_ROUTE_OPTIONS_H
+
+#include <tuple>
+
+// Purpose: How a path should be chosen, per job. The default options are served by all of the
+// precomputed data (path cache, shortest path trees, first-move tables); any other options always search.
+struct NABE_RouteOptions {
+	// Areas with any of these attributes (NAV_MESH_*) are never entered, except the start area.
+	int avoid_attributes = 0;
+	// Areas with these attributes are entered without their usual penalty (NAV_MESH_CROUCH, NAV_MESH_JUMP),
+	// eg. for a class that crouches as fast as it runs.
+	int allow_attributes = 0;
+	// Whether to prefer the areas that have recently been less dangerous for the team (see NABE_DangerField),
+	// like the SAFEST_ROUTE of nav_pathfind.h.
+	bool safest = false;
+	int team = 0;
+	// Which danger the safest route weighs, see NABE_PathFinder::AddDangerLayer. Set by the job source, not the job.
+	int danger_layer = 0;
+	// Seconds since the round started, or negative for a team agnostic route. If set, the areas that the team's
+	// enemies can already have reached by then (the nav_teams earliest occupy times) are avoided, or with
+	// seek_enemy, preferred.
+	int round_time = -1;
+	bool seek_enemy = false;
+
+	bool IsDefault() const { return avoid_attributes == 0 && allow_attributes == 0 && !safest && round_time < 0; }
+	bool IsTeamAware() const { return round_time >= 0; }
+
+	bool operator<(const NABE_RouteOptions& other) const
+	{
+		return std::tie(avoid_attributes, allow_attributes, safest, team, danger_layer, round_time, seek_enemy) <
+			std::tie(other.avoid_attributes, other.allow_attributes, other.safest, other.team, other.danger_layer,
+				other.round_time, other.seek_enemy);
+	}
+};
+
+#endif // NABENABE_ROUTE_OPTIONS_H
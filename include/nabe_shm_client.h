@@ -0,0 +1,124 @@
+#ifndef NABENABE_SHM_CLIENT_H
+#define NABENABE_SHM_CLIENT_H
+
+// Reference client for NABE_ShmServer. Header only and without nabe dependencies beyond the protocol headers,
+// so it can be dropped into another project (eg. a SourceMod extension). Linux only.
+
+#include "nabe_shm_ring.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+class NABE_ShmClient
+{
+public:
+	~NABE_ShmClient()
+	{
+		Close();
+	}
+
+	// Attach to the segment created by nabe. Only one client may be attached to a segment at a time.
+	bool Open(const std::string& shm_name)
+	{
+		Close();
+
+		const int fd = shm_open(shm_name.c_str(), O_RDWR, 0);
+		if (fd == -1) {
+			return false;
+		}
+
+		struct stat st;
+		if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(NABE_ShmSegmentHeader)) {
+			close(fd);
+			return false;
+		}
+
+		auto segment = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		if (segment == MAP_FAILED) {
+			return false;
+		}
+		m_segment = segment;
+		m_segment_size = st.st_size;
+
+		auto header = static_cast<NABE_ShmSegmentHeader*>(m_segment);
+		const auto magic = header->magic;
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (magic != NABE_SHM_MAGIC || header->version != NABE_SHM_VERSION ||
+			NABE_ShmSegmentSize(header->ring_capacity) > m_segment_size)
+		{
+			Close();
+			return false;
+		}
+
+		NABE_ShmGetRings(m_segment, header->ring_capacity, m_requests, m_responses);
+		return true;
+	}
+
+	void Close()
+	{
+		if (m_segment) {
+			munmap(m_segment, m_segment_size);
+			m_segment = nullptr;
+		}
+	}
+
+	// Queue a request without waiting for its response. Returns false if the request ring is full.
+	bool Send(const NABE_IpcRequestHeader& header, const std::string& map_name)
+	{
+		auto payload = m_requests.Reserve(NABE_IpcRequestPayloadSize(map_name));
+		if (!payload) {
+			return false;
+		}
+		NABE_IpcWriteRequest(payload, header, map_name);
+		m_requests.Commit();
+		return true;
+	}
+
+	// Get the next response, spinning for a while before sleeping, for up to timeout_ms.
+	bool Receive(NABE_IpcResponseHeader& out_header, std::vector<float>& out_waypoints, int timeout_ms)
+	{
+		constexpr int num_spins = 2000;
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+		for (int i = 0;; ++i) {
+			const auto seen_sequence = m_responses.GetSequence();
+
+			uint32_t payload_size;
+			if (auto payload = m_responses.Peek(payload_size)) {
+				const bool ok = NABE_IpcDecodeResponse(payload, payload_size, out_header, out_waypoints);
+				m_responses.Release();
+				return ok;
+			}
+
+			const auto time_left_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+				deadline - std::chrono::steady_clock::now()).count();
+			if (time_left_ms <= 0) {
+				return false;
+			}
+			if (i >= num_spins) {
+				m_responses.Wait(seen_sequence, static_cast<int>(time_left_ms));
+			}
+		}
+	}
+
+	// Send a request, and wait for its response.
+	bool Request(const NABE_IpcRequestHeader& header, const std::string& map_name,
+		NABE_IpcResponseHeader& out_header, std::vector<float>& out_waypoints, int timeout_ms = 1000)
+	{
+		return Send(header, map_name) && Receive(out_header, out_waypoints, timeout_ms);
+	}
+
+private:
+	void* m_segment = nullptr;
+	size_t m_segment_size = 0;
+	NABE_ShmRing m_requests;
+	NABE_ShmRing m_responses;
+};
+
+#endif // NABENABE_SHM_CLIENT_H
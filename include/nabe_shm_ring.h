@@ -0,0 +1,219 @@
+#ifndef NABENABE_SHM_RING_H
+#define NABENABE_SHM_RING_H
+
+// Shared memory layout for exchanging nabe_ipc_protocol.h messages between two processes.
+// Linux only, since the wakeups rely on futexes.
+
+#include "nabe_ipc_protocol.h"
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+constexpr uint32_t NABE_SHM_MAGIC = 0x4542414E; // "NABE"
+constexpr uint32_t NABE_SHM_VERSION = 1;
+
+// Purpose: Control block of a single producer, single consumer ring buffer.
+// Messages are stored contiguously as their uint32_t payload size followed by the payload, padded to 4 bytes.
+// A message that doesn't fit before the end of the buffer is preceded by a wrap marker, and starts from the beginning,
+// so that both sides can always access the payload in place.
+struct NABE_ShmRingHeader {
+	// Byte offsets, increasing forever. Position in the buffer is offset modulo capacity.
+	alignas(64) std::atomic<uint64_t> head;	// Written by the producer.
+	alignas(64) std::atomic<uint64_t> tail;	// Written by the consumer.
+	// Bumped after every change of head or tail, and used as the futex word for waiting on the other side.
+	alignas(64) std::atomic<uint32_t> seq;
+	std::atomic<uint32_t> num_waiters;
+	uint32_t capacity;
+};
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+	"Shared memory atomics must be lock free");
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "Futex word must be 32 bits");
+
+// Purpose: Layout at the start of the shared memory segment. The request ring's data follows this header,
+// and the response ring's data follows that.
+struct NABE_ShmSegmentHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t ring_capacity;
+	NABE_ShmRingHeader requests;	// Client produces, nabe consumes.
+	NABE_ShmRingHeader responses;	// Nabe produces, client consumes.
+};
+
+constexpr size_t NABE_ShmSegmentSize(uint32_t ring_capacity)
+{
+	return ((sizeof(NABE_ShmSegmentHeader) + 63) & ~size_t(63)) + 2 * static_cast<size_t>(ring_capacity);
+}
+
+// Purpose: One side's view of a ring in shared memory. Not thread safe; each side of a ring must only be
+// used by a single thread.
+// The capacity is given by the side that knows it, rather than read from the shared header, and the offsets
+// the other side writes are checked against it, so that a misbehaving process can't make us read out of bounds.
+class NABE_ShmRing
+{
+public:
+	NABE_ShmRing() = default;
+	NABE_ShmRing(NABE_ShmRingHeader* header, uint8_t* data, uint32_t capacity)
+		: m_header(header), m_data(data), m_capacity(capacity)
+	{
+	}
+
+	void Init()
+	{
+		m_header->head.store(0, std::memory_order_relaxed);
+		m_header->tail.store(0, std::memory_order_relaxed);
+		m_header->seq.store(0, std::memory_order_relaxed);
+		m_header->num_waiters.store(0, std::memory_order_relaxed);
+		m_header->capacity = m_capacity;
+	}
+
+	// Producer: get space for a payload of payload_size bytes, or nullptr if the ring is too full for it.
+	// The payload becomes visible to the consumer on Commit.
+	uint8_t* Reserve(uint32_t payload_size)
+	{
+		const uint64_t capacity = m_capacity;
+		const uint64_t needed = Align(sizeof(uint32_t) + payload_size);
+		if (needed > capacity) {
+			return nullptr;
+		}
+
+		uint64_t head = m_header->head.load(std::memory_order_relaxed);
+		const uint64_t tail = m_header->tail.load(std::memory_order_acquire);
+
+		const uint64_t pos = head % capacity;
+		const uint64_t contiguous = capacity - pos;
+		const uint64_t wrap = (needed > contiguous) ? contiguous : 0;
+		if (head + wrap + needed - tail > capacity) {
+			return nullptr;
+		}
+
+		if (wrap != 0) {
+			constexpr uint32_t wrap_marker = UINT32_MAX;
+			memcpy(m_data + pos, &wrap_marker, sizeof(wrap_marker));
+			head += wrap;
+		}
+
+		uint8_t* message = m_data + (head % capacity);
+		memcpy(message, &payload_size, sizeof(payload_size));
+		m_pending = head + needed;
+		return message + sizeof(uint32_t);
+	}
+
+	void Commit()
+	{
+		m_header->head.store(m_pending, std::memory_order_release);
+		Notify();
+	}
+
+	// Consumer: get the oldest payload, or nullptr if the ring is empty or corrupt (see IsCorrupt).
+	// The payload stays valid until Release.
+	const uint8_t* Peek(uint32_t& out_payload_size)
+	{
+		const uint64_t capacity = m_capacity;
+		uint64_t tail = m_header->tail.load(std::memory_order_relaxed);
+		const uint64_t head = m_header->head.load(std::memory_order_acquire);
+		if (tail == head) {
+			return nullptr;
+		}
+		// Unsigned, so a head behind the tail fails this too.
+		if (head - tail > capacity || tail % sizeof(uint32_t) != 0) {
+			m_corrupt = true;
+			return nullptr;
+		}
+
+		uint32_t size;
+		memcpy(&size, m_data + (tail % capacity), sizeof(size));
+		if (size == UINT32_MAX) {
+			tail += capacity - (tail % capacity);
+			if (head <= tail) {
+				m_corrupt = true;
+				return nullptr;
+			}
+			memcpy(&size, m_data + (tail % capacity), sizeof(size));
+		}
+
+		// The message must have been committed, and never runs past the end of the buffer.
+		const uint64_t needed = Align(sizeof(uint32_t) + static_cast<uint64_t>(size));
+		if (needed > head - tail || needed > capacity - (tail % capacity)) {
+			m_corrupt = true;
+			return nullptr;
+		}
+
+		m_pending = tail + needed;
+		out_payload_size = size;
+		return m_data + (tail % capacity) + sizeof(uint32_t);
+	}
+
+	void Release()
+	{
+		m_header->tail.store(m_pending, std::memory_order_release);
+		Notify();
+	}
+
+	// Whether Peek found offsets or sizes that can't have been written by a well behaved producer.
+	// Nothing more can be read from a corrupt ring; Discard drops its contents.
+	bool IsCorrupt() const { return m_corrupt; }
+
+	// Consumer: drop everything in the ring, and start over from the producer's head.
+	void Discard()
+	{
+		m_header->tail.store(m_header->head.load(std::memory_order_acquire), std::memory_order_release);
+		m_corrupt = false;
+		Notify();
+	}
+
+	// Sample before checking the ring, and pass to Wait, so that changes in between won't be slept through.
+	uint32_t GetSequence() const
+	{
+		return m_header->seq.load(std::memory_order_acquire);
+	}
+
+	// Sleep until the other side changes the ring after seen_sequence, or the timeout passes.
+	void Wait(uint32_t seen_sequence, int timeout_ms)
+	{
+		m_header->num_waiters.fetch_add(1, std::memory_order_seq_cst);
+		if (m_header->seq.load(std::memory_order_seq_cst) == seen_sequence) {
+			timespec timeout{ timeout_ms / 1000, (timeout_ms % 1000) * 1000000L };
+			syscall(SYS_futex, reinterpret_cast<uint32_t*>(&m_header->seq), FUTEX_WAIT, seen_sequence,
+				(timeout_ms < 0 ? nullptr : &timeout), nullptr, 0);
+		}
+		m_header->num_waiters.fetch_sub(1, std::memory_order_seq_cst);
+	}
+
+private:
+	static uint64_t Align(uint64_t size)
+	{
+		return (size + 3) & ~uint64_t(3);
+	}
+
+	// Only costs a syscall if the other side is actually sleeping.
+	void Notify()
+	{
+		m_header->seq.fetch_add(1, std::memory_order_seq_cst);
+		if (m_header->num_waiters.load(std::memory_order_seq_cst) != 0) {
+			syscall(SYS_futex, reinterpret_cast<uint32_t*>(&m_header->seq), FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+		}
+	}
+
+	NABE_ShmRingHeader* m_header = nullptr;
+	uint8_t* m_data = nullptr;
+	uint32_t m_capacity = 0;
+	uint64_t m_pending = 0;
+	bool m_corrupt = false;
+};
+
+// Get the views of both rings of a mapped segment, whose rings are ring_capacity bytes each.
+inline void NABE_ShmGetRings(void* segment, uint32_t ring_capacity, NABE_ShmRing& out_requests, NABE_ShmRing& out_responses)
+{
+	auto header = static_cast<NABE_ShmSegmentHeader*>(segment);
+	auto data = static_cast<uint8_t*>(segment) + ((sizeof(NABE_ShmSegmentHeader) + 63) & ~size_t(63));
+	out_requests = NABE_ShmRing(&header->requests, data, ring_capacity);
+	out_responses = NABE_ShmRing(&header->responses, data + ring_capacity, ring_capacity);
+}
+
+#endif // NABENABE_SHM_RING_H
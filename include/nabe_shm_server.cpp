@@ -0,0 +1,207 @@
+#include "nabe_shm_server.h"
+
+#include "nabe_ipc_jobs.h"
+#include "print_helpers.h"
+
+#include <algorithm>
+
+#ifdef __linux__
+#include "nabe_shm_ring.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+NABE_ShmServer::NABE_ShmServer(const std::string& shm_name, uint32_t ring_capacity, bool verbosity)
+	: m_shm_name(shm_name),
+	m_ring_capacity(ring_capacity),
+	m_verbosity(verbosity)
+{
+}
+
+void NABE_ShmServer::WriteResult(const NABE_Job& job, const NABE_JobResult& result)
+{
+	std::vector<float> waypoints;
+	NABE_IpcGetWaypoints(result, waypoints);
+	WriteResponse(static_cast<uint32_t>(job.id), NABE_IpcGetStatus(result.status), waypoints);
+}
+
+#ifndef __linux__
+NABE_ShmServer::~NABE_ShmServer()
+{
+}
+
+bool NABE_ShmServer::Start()
+{
+	print(Error, "%s: The shared memory server is not supported on this platform.", __FUNCTION__);
+	return false;
+}
+
+void NABE_ShmServer::FetchJobs(std::vector<NABE_Job>& out_jobs) {}
+void NABE_ShmServer::WaitForJobs(int timeout_ms) {}
+void NABE_ShmServer::WriteResponse(uint32_t request_id, NABE_IpcStatus status, const std::vector<float>& waypoints) {}
+bool NABE_ShmServer::FlushResponses() { return true; }
+#else
+NABE_ShmServer::~NABE_ShmServer()
+{
+	if (m_segment) {
+		munmap(m_segment, m_segment_size);
+		shm_unlink(m_shm_name.c_str());
+	}
+}
+
+bool NABE_ShmServer::Start()
+{
+	if (m_shm_name.size() < 2 || m_shm_name[0] != '/' || m_shm_name.find('/', 1) != std::string::npos) {
+		print(Error, "%s: Invalid shared memory name: \"%s\" (expected \"/name\")", __FUNCTION__, m_shm_name.c_str());
+		return false;
+	}
+	if (m_ring_capacity < 4096 || m_ring_capacity % 64 != 0) {
+		print(Error, "%s: Invalid ring capacity %u: must be a multiple of 64, and at least 4096", __FUNCTION__, m_ring_capacity);
+		return false;
+	}
+
+	shm_unlink(m_shm_name.c_str());
+	const int fd = shm_open(m_shm_name.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+	if (fd == -1) {
+		print(Error, "%s: Failed to create shared memory \"%s\" (errno %d)", __FUNCTION__, m_shm_name.c_str(), errno);
+		return false;
+	}
+
+	m_segment_size = NABE_ShmSegmentSize(m_ring_capacity);
+	if (ftruncate(fd, static_cast<off_t>(m_segment_size)) != 0) {
+		print(Error, "%s: Failed to size shared memory (errno %d)", __FUNCTION__, errno);
+		close(fd);
+		shm_unlink(m_shm_name.c_str());
+		return false;
+	}
+
+	auto segment = mmap(nullptr, m_segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (segment == MAP_FAILED) {
+		print(Error, "%s: Failed to map shared memory (errno %d)", __FUNCTION__, errno);
+		shm_unlink(m_shm_name.c_str());
+		return false;
+	}
+	m_segment = segment;
+
+	auto header = static_cast<NABE_ShmSegmentHeader*>(m_segment);
+	header->ring_capacity = m_ring_capacity;
+	NABE_ShmRing requests, responses;
+	NABE_ShmGetRings(m_segment, m_ring_capacity, requests, responses);
+	requests.Init();
+	responses.Init();
+	header->version = NABE_SHM_VERSION;
+	// Clients check this last, so they never see a half initialized segment.
+	std::atomic_thread_fence(std::memory_order_release);
+	header->magic = NABE_SHM_MAGIC;
+
+	print(Info, "Listening for path requests at shared memory: \"%s\"", m_shm_name.c_str());
+	return true;
+}
+
+void NABE_ShmServer::FetchJobs(std::vector<NABE_Job>& out_jobs)
+{
+	if (!m_segment || !FlushResponses()) {
+		return;
+	}
+
+	NABE_ShmRing requests, responses;
+	NABE_ShmGetRings(m_segment, m_ring_capacity, requests, responses);
+
+	uint32_t payload_size;
+	while (auto payload = requests.Peek(payload_size)) {
+		NABE_IpcRequest request;
+		if (NABE_IpcDecodeRequest(payload, payload_size, request)) {
+			out_jobs.push_back(NABE_IpcRequestToJob(request, request.header.request_id));
+		}
+		else {
+			// There's no connection to drop, so answer with an error instead.
+			// The request id may be garbage, but it's the best we have.
+			uint32_t request_id = 0;
+			memcpy(&request_id, payload, std::min<size_t>(payload_size, sizeof(request_id)));
+			WriteResponse(request_id, NABE_IPC_STATUS_BAD_REQUEST, {});
+		}
+		requests.Release();
+	}
+
+	// The client wrote something we can't make sense of. Its requests are lost either way, but it can start over.
+	if (requests.IsCorrupt()) {
+		print(Error, "%s: Request ring of \"%s\" is corrupt, discarding its requests.", __FUNCTION__, m_shm_name.c_str());
+		requests.Discard();
+	}
+}
+
+void NABE_ShmServer::WaitForJobs(int timeout_ms)
+{
+	if (!m_segment) {
+		return;
+	}
+
+	NABE_ShmRing requests, responses;
+	NABE_ShmGetRings(m_segment, m_ring_capacity, requests, responses);
+
+	// Can't take new requests before the client has made room for the previous responses.
+	if (!m_overflow.empty()) {
+		const auto seen_sequence = responses.GetSequence();
+		if (!FlushResponses()) {
+			responses.Wait(seen_sequence, timeout_ms);
+		}
+		return;
+	}
+
+	const auto seen_sequence = requests.GetSequence();
+	uint32_t payload_size;
+	if (!requests.Peek(payload_size) && !requests.IsCorrupt()) {
+		requests.Wait(seen_sequence, timeout_ms);
+	}
+}
+
+void NABE_ShmServer::WriteResponse(uint32_t request_id, NABE_IpcStatus status, const std::vector<float>& waypoints)
+{
+	const auto payload_size = NABE_IpcResponsePayloadSize(waypoints);
+
+	if (m_overflow.empty()) {
+		NABE_ShmRing requests, responses;
+		NABE_ShmGetRings(m_segment, m_ring_capacity, requests, responses);
+		if (auto response = responses.Reserve(payload_size)) {
+			NABE_IpcWriteResponse(response, request_id, status, waypoints);
+			responses.Commit();
+			return;
+		}
+		if (m_verbosity) {
+			print(Warning, "%s: Response ring is full.", __FUNCTION__);
+		}
+	}
+
+	// Client isn't reading its responses; keep this for later, in order.
+	m_overflow.emplace_back(payload_size);
+	NABE_IpcWriteResponse(m_overflow.back().data(), request_id, status, waypoints);
+}
+
+bool NABE_ShmServer::FlushResponses()
+{
+	if (m_overflow.empty()) {
+		return true;
+	}
+
+	NABE_ShmRing requests, responses;
+	NABE_ShmGetRings(m_segment, m_ring_capacity, requests, responses);
+
+	size_t num_written = 0;
+	for (auto& payload : m_overflow) {
+		auto response = responses.Reserve(static_cast<uint32_t>(payload.size()));
+		if (!response) {
+			break;
+		}
+		memcpy(response, payload.data(), payload.size());
+		responses.Commit();
+		++num_written;
+	}
+	m_overflow.erase(m_overflow.begin(), m_overflow.begin() + num_written);
+
+	return m_overflow.empty();
+}
+#endif
@@ -0,0 +1,51 @@
+#ifndef NABENABE_SHM_SERVER_H
+#define NABENABE_SHM_SERVER_H
+
+#include "nabe_ipc_protocol.h"
+#include "nabe_job_source.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Purpose: Serves path requests through a POSIX shared memory segment, holding a request ring and a response ring
+// (see nabe_shm_ring.h), using the messages of nabe_ipc_protocol.h.
+// Requests are read and responses written in place, and the only syscalls are futex waits/wakes
+// when one side is actually idle. Requests are solved by NABE_JobDispatcher, like the database jobs.
+// The rings are single producer, single consumer, so each segment serves exactly one client process.
+// See nabe_shm_client.h for a reference client. Currently only supported on Linux.
+class NABE_ShmServer : public NABE_JobSource, public NABE_ResultSink
+{
+public:
+	NABE_ShmServer(const std::string& shm_name, uint32_t ring_capacity, bool verbosity);
+	~NABE_ShmServer();
+
+	// Create the shared memory segment. Any stale segment of the same name is replaced.
+	bool Start();
+
+	// NABE_JobSource
+	void FetchJobs(std::vector<NABE_Job>& out_jobs) override;
+	bool CanWaitForJobs() const override { return true; }
+	void WaitForJobs(int timeout_ms) override;
+
+	// NABE_ResultSink
+	void WriteResult(const NABE_Job& job, const NABE_JobResult& result) override;
+
+private:
+	// Write a response to the response ring, or queue it if the ring is full.
+	void WriteResponse(uint32_t request_id, NABE_IpcStatus status, const std::vector<float>& waypoints);
+	// Write queued responses. Returns false if some are still left.
+	bool FlushResponses();
+
+	std::string m_shm_name;
+	uint32_t m_ring_capacity;
+	void* m_segment = nullptr;
+	size_t m_segment_size = 0;
+	// Response payloads that didn't fit in the response ring yet, because the client is behind on reading them.
+	// No more requests are read until these are written.
+	std::vector<std::vector<uint8_t>> m_overflow;
+	bool m_verbosity;
+};
+
+#endif // NABENABE_SHM_SERVER_H
@@ -0,0 +1,266 @@
+#include "nabe_socket_server.h"
+
+#include "nabe_ipc_jobs.h"
+#include "print_helpers.h"
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+
+NABE_SocketServer::NABE_SocketServer(const std::string& socket_path, bool verbosity)
+	: m_socket_path(socket_path),
+	m_verbosity(verbosity)
+{
+}
+
+NABE_SocketServer::~NABE_SocketServer()
+{
+#ifndef _WIN32
+	for (auto& client : m_clients) {
+		close(client.fd);
+	}
+	m_clients.clear();
+
+	if (m_listen_fd != -1) {
+		close(m_listen_fd);
+		unlink(m_socket_path.c_str());
+	}
+#endif
+}
+
+void NABE_SocketServer::FetchJobs(std::vector<NABE_Job>& out_jobs)
+{
+	Pump(0);
+	for (auto& job : m_pending_jobs) {
+		out_jobs.push_back(std::move(job));
+	}
+	m_pending_jobs.clear();
+}
+
+void NABE_SocketServer::WaitForJobs(int timeout_ms)
+{
+	if (m_pending_jobs.empty()) {
+		Pump(timeout_ms);
+	}
+}
+
+void NABE_SocketServer::WriteResult(const NABE_Job& job, const NABE_JobResult& result)
+{
+	const auto serial = static_cast<uint32_t>(static_cast<unsigned long long>(job.id) >> 32);
+	const auto request_id = static_cast<uint32_t>(job.id & 0xFFFFFFFF);
+
+	auto client = std::find_if(m_clients.begin(), m_clients.end(),
+		[serial](const Client& c) { return c.serial == serial; });
+	if (client == m_clients.end()) {
+		return; // Disconnected while we were solving.
+	}
+
+	std::vector<float> waypoints;
+	NABE_IpcGetWaypoints(result, waypoints);
+	NABE_IpcEncodeResponse(request_id, NABE_IpcGetStatus(result.status), waypoints, client->out);
+}
+
+#ifdef _WIN32
+bool NABE_SocketServer::Start()
+{
+	print(Error, "%s: The socket server is not supported on this platform.", __FUNCTION__);
+	return false;
+}
+
+void NABE_SocketServer::EndResults() {}
+void NABE_SocketServer::Pump(int timeout_ms) {}
+void NABE_SocketServer::Accept() {}
+bool NABE_SocketServer::Read(Client& client) { return false; }
+bool NABE_SocketServer::Write(Client& client) { return false; }
+void NABE_SocketServer::Disconnect(Client& client) {}
+void NABE_SocketServer::RemoveDisconnected() {}
+#else
+bool NABE_SocketServer::Start()
+{
+	sockaddr_un addr{};
+	addr.sun_family = AF_UNIX;
+	if (m_socket_path.empty() || m_socket_path.size() >= sizeof(addr.sun_path)) {
+		print(Error, "%s: Invalid socket path: \"%s\"", __FUNCTION__, m_socket_path.c_str());
+		return false;
+	}
+	memcpy(addr.sun_path, m_socket_path.c_str(), m_socket_path.size() + 1);
+
+	m_listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (m_listen_fd == -1) {
+		print(Error, "%s: Failed to create socket (errno %d)", __FUNCTION__, errno);
+		return false;
+	}
+
+	unlink(m_socket_path.c_str());
+	if (bind(m_listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+		listen(m_listen_fd, SOMAXCONN) != 0)
+	{
+		print(Error, "%s: Failed to listen at \"%s\" (errno %d)", __FUNCTION__, m_socket_path.c_str(), errno);
+		close(m_listen_fd);
+		m_listen_fd = -1;
+		return false;
+	}
+
+	print(Info, "Listening for path requests at: \"%s\"", m_socket_path.c_str());
+	return true;
+}
+
+void NABE_SocketServer::Pump(int timeout_ms)
+{
+	if (m_listen_fd == -1) {
+		return;
+	}
+
+	std::vector<pollfd> fds(m_clients.size() + 1);
+	fds[0] = { m_listen_fd, POLLIN, 0 };
+	for (size_t i = 0; i < m_clients.size(); ++i) {
+		fds[i + 1] = { m_clients[i].fd, static_cast<short>(POLLIN | (m_clients[i].out.empty() ? 0 : POLLOUT)), 0 };
+	}
+
+	if (poll(fds.data(), fds.size(), timeout_ms) <= 0) {
+		return;
+	}
+
+	for (size_t i = 0; i < m_clients.size(); ++i) {
+		const auto revents = fds[i + 1].revents;
+		auto& client = m_clients[i];
+		bool keep = true;
+		if (revents & (POLLIN | POLLHUP | POLLERR)) {
+			keep = Read(client);
+		}
+		if (keep && !client.out.empty()) {
+			keep = Write(client);
+		}
+		if (!keep) {
+			Disconnect(client);
+		}
+	}
+	RemoveDisconnected();
+
+	if (fds[0].revents & POLLIN) {
+		Accept();
+	}
+}
+
+void NABE_SocketServer::EndResults()
+{
+	for (auto& client : m_clients) {
+		if (!client.out.empty() && !Write(client)) {
+			Disconnect(client);
+		}
+	}
+	RemoveDisconnected();
+}
+
+void NABE_SocketServer::Accept()
+{
+	for (;;) {
+		const int fd = accept4(m_listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (fd == -1) {
+			if (errno != EAGAIN && errno != EWOULDBLOCK) {
+				print(Warning, "%s: Failed to accept connection (errno %d)", __FUNCTION__, errno);
+			}
+			return;
+		}
+		if (m_verbosity) {
+			print(Info, "%s: Client connected (fd %d)", __FUNCTION__, fd);
+		}
+		Client client;
+		client.fd = fd;
+		client.serial = m_next_serial++;
+		m_clients.push_back(std::move(client));
+	}
+}
+
+bool NABE_SocketServer::Read(Client& client)
+{
+	uint8_t buffer[16 * 1024];
+	for (;;) {
+		const auto num_read = recv(client.fd, buffer, sizeof(buffer), 0);
+		if (num_read > 0) {
+			client.in.insert(client.in.end(), buffer, buffer + num_read);
+			continue;
+		}
+		if (num_read == 0) {
+			return false; // Disconnected.
+		}
+		if (errno == EAGAIN || errno == EWOULDBLOCK) {
+			break;
+		}
+		if (errno != EINTR) {
+			return false;
+		}
+	}
+
+	// Queue every complete message in the buffer.
+	size_t offset = 0;
+	while (client.in.size() - offset >= sizeof(uint32_t)) {
+		uint32_t payload_size;
+		memcpy(&payload_size, client.in.data() + offset, sizeof(payload_size));
+		if (payload_size > NABE_IPC_MAX_MESSAGE_SIZE) {
+			print(Warning, "%s: Request of %u bytes exceeds the max size, dropping client.", __FUNCTION__, payload_size);
+			return false;
+		}
+		if (client.in.size() - offset - sizeof(payload_size) < payload_size) {
+			break; // Wait for the rest of it.
+		}
+
+		NABE_IpcRequest request;
+		if (!NABE_IpcDecodeRequest(client.in.data() + offset + sizeof(payload_size), payload_size, request)) {
+			print(Warning, "%s: Malformed request, dropping client.", __FUNCTION__);
+			return false;
+		}
+		const auto job_id = static_cast<long long>((static_cast<unsigned long long>(client.serial) << 32) |
+			request.header.request_id);
+		m_pending_jobs.push_back(NABE_IpcRequestToJob(request, job_id));
+
+		offset += sizeof(payload_size) + payload_size;
+	}
+	client.in.erase(client.in.begin(), client.in.begin() + offset);
+
+	return true;
+}
+
+bool NABE_SocketServer::Write(Client& client)
+{
+	size_t offset = 0;
+	while (offset < client.out.size()) {
+		const auto num_sent = send(client.fd, client.out.data() + offset, client.out.size() - offset, MSG_NOSIGNAL);
+		if (num_sent > 0) {
+			offset += num_sent;
+			continue;
+		}
+		if (num_sent == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			break; // Socket buffer is full, try again on the next poll.
+		}
+		if (num_sent == -1 && errno == EINTR) {
+			continue;
+		}
+		return false;
+	}
+	client.out.erase(client.out.begin(), client.out.begin() + offset);
+	return true;
+}
+
+void NABE_SocketServer::Disconnect(Client& client)
+{
+	if (m_verbosity) {
+		print(Info, "%s: Client disconnected (fd %d)", __FUNCTION__, client.fd);
+	}
+	close(client.fd);
+	client.fd = -1;
+}
+
+void NABE_SocketServer::RemoveDisconnected()
+{
+	m_clients.erase(std::remove_if(m_clients.begin(), m_clients.end(),
+		[](const Client& c) { return c.fd == -1; }), m_clients.end());
+}
+#endif
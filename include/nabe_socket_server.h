@@ -0,0 +1,60 @@
+#ifndef NABENABE_SOCKET_SERVER_H
+#define NABENABE_SOCKET_SERVER_H
+
+#include "nabe_ipc_protocol.h"
+#include "nabe_job_source.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Purpose: Serves path requests over a local Unix domain socket, using the protocol in nabe_ipc_protocol.h.
+// This is an optional low latency alternative to polling the database for jobs.
+// Requests are solved by NABE_JobDispatcher, like the database jobs, and can be waited on.
+// Currently only supported on Linux.
+class NABE_SocketServer : public NABE_JobSource, public NABE_ResultSink
+{
+public:
+	NABE_SocketServer(const std::string& socket_path, bool verbosity);
+	~NABE_SocketServer();
+
+	// Start listening. Any stale socket file left at the path (eg. by a crashed nabe) is replaced.
+	bool Start();
+
+	// NABE_JobSource
+	void FetchJobs(std::vector<NABE_Job>& out_jobs) override;
+	bool CanWaitForJobs() const override { return true; }
+	void WaitForJobs(int timeout_ms) override;
+
+	// NABE_ResultSink
+	void WriteResult(const NABE_Job& job, const NABE_JobResult& result) override;
+	// Responses are sent once the whole batch has been written.
+	void EndResults() override;
+
+private:
+	struct Client {
+		int fd = -1;
+		// Job ids carry this, so that results can find their way back even if other clients have disconnected.
+		uint32_t serial = 0;
+		std::vector<uint8_t> in;
+		std::vector<uint8_t> out;
+	};
+
+	// Wait up to timeout_ms for activity, and queue every complete request that has arrived.
+	void Pump(int timeout_ms);
+	void Accept();
+	// Returns false if the client should be disconnected.
+	bool Read(Client& client);
+	bool Write(Client& client);
+	void Disconnect(Client& client);
+	void RemoveDisconnected();
+
+	std::string m_socket_path;
+	std::vector<Client> m_clients;
+	std::vector<NABE_Job> m_pending_jobs;
+	uint32_t m_next_serial = 0;
+	int m_listen_fd = -1;
+	bool m_verbosity;
+};
+
+#endif // NABENABE_SOCKET_SERVER_H
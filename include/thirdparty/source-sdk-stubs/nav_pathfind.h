@@ -4,6 +4,7 @@
 #include "thirdparty/source-sdk-stubs/nav.h"
 #include "thirdparty/source-sdk-stubs/nav_area.h"
 
+#include <chrono>
 #include <unordered_set>
 
 // The code in this file is based on the Source 1 SDK, and is used under the SOURCE 1 SDK LICENSE.
@@ -64,7 +65,7 @@ enum RouteType
 	SAFEST_ROUTE,
 };
 
-float CostFunctor(CNavArea* area, CNavArea* fromArea)
+float CostFunctor(CNavArea* area, CNavArea* fromArea, int penaltyFreeAttributes = 0)
 {
 	if (fromArea == nullptr)
 	{
@@ -87,15 +88,17 @@ float CostFunctor(CNavArea* area, CNavArea* fromArea)
 
 		float cost = dist + fromArea->GetCostSoFar();
 
+		const int attributes = area->GetAttributes() & ~penaltyFreeAttributes;
+
 		// if this is a "crouch" area, add penalty
-		if (area->GetAttributes() & NAV_MESH_CROUCH)
+		if (attributes & NAV_MESH_CROUCH)
 		{
 			const float crouchPenalty = 20.0f;		// 10
 			cost += crouchPenalty * dist;
 		}
 
 		// if this is a "jump" area, add penalty
-		if (area->GetAttributes() & NAV_MESH_JUMP)
+		if (attributes & NAV_MESH_JUMP)
 		{
 			const float jumpPenalty = 5.0f;
 			cost += jumpPenalty * dist;
@@ -105,6 +108,123 @@ float CostFunctor(CNavArea* area, CNavArea* fromArea)
 	}
 }
 
+/**
+ * Limits of a single search. Zero means no limit.
+ */
+struct NavSearchBudget
+{
+	size_t maxExpansions = 0;
+	long long maxMicroseconds = 0;
+
+	// Set by NavAreaBuildPath if the search gave up because of the limits.
+	bool exhausted = false;
+};
+
+//--------------------------------------------------------------------------------------------------------------
+// Cost and heuristic policies for NavAreaBuildPath. Each combination is a separate instantiation,
+// so the policies are inlined into the search loop and cost nothing for the searches not using them.
+//
+// A cost policy returns the total cost of reaching 'area' from the start through 'fromArea',
+// (or the initial cost, if 'fromArea' is NULL), or a negative value if 'area' must not be entered.
+
+/**
+ * Shortest route, avoiding crouch and jump areas where reasonable. Same as CostFunctor.
+ * Areas with any of the allowed attributes (NAV_MESH_*) are entered without their penalty.
+ */
+struct FastestRouteCost
+{
+	int allowAttributes = 0;
+
+	float operator()(CNavArea* area, CNavArea* fromArea) const
+	{
+		return CostFunctor(area, fromArea, allowAttributes);
+	}
+};
+
+/**
+ * Shortest route, weighted by how dangerous each area is for the team.
+ * The DangerSource provides float GetDanger(const CNavArea* area, int teamID), with 0 meaning safe.
+ */
+template <typename DangerSource>
+struct SafestRouteCost
+{
+	const DangerSource& danger;
+	int teamID;
+	float dangerFactor = 100.0f;
+	// As in FastestRouteCost.
+	int allowAttributes = 0;
+
+	float operator()(CNavArea* area, CNavArea* fromArea) const
+	{
+		float cost = CostFunctor(area, fromArea, allowAttributes);
+		if (fromArea != NULL && cost >= 0.0f)
+		{
+			const float dist = (area->GetCenter() - fromArea->GetCenter()).Length();
+			cost += dist * dangerFactor * danger.GetDanger(area, teamID);
+		}
+		return cost;
+	}
+};
+
+/**
+ * Any other route cost, never entering areas with any of the given attributes (NAV_MESH_*).
+ */
+template <typename BaseCost>
+struct AvoidAttributesCost
+{
+	BaseCost base;
+	int avoidAttributes;
+
+	float operator()(CNavArea* area, CNavArea* fromArea) const
+	{
+		if (fromArea != NULL && (area->GetAttributes() & avoidAttributes))
+			return -1.0f;
+		return base(area, fromArea);
+	}
+};
+
+/**
+ * Any other route cost, weighted by whether the enemy team can already be in each area by the given time.
+ * The OccupySource provides float GetEarliestOccupyTime(const CNavArea* area, int teamID), in seconds since
+ * the round started. With seekEnemy, the areas the enemy can't have reached yet are the ones penalized instead.
+ */
+template <typename BaseCost, typename OccupySource>
+struct EnemyOccupyCost
+{
+	BaseCost base;
+	const OccupySource& occupy;
+	int enemyTeamID;
+	float roundTime;
+	bool seekEnemy = false;
+	float enemyFactor = 10.0f;
+
+	float operator()(CNavArea* area, CNavArea* fromArea) const
+	{
+		float cost = base(area, fromArea);
+		if (fromArea != NULL && cost >= 0.0f)
+		{
+			const bool enemyCanBeHere = occupy.GetEarliestOccupyTime(area, enemyTeamID) <= roundTime;
+			if (enemyCanBeHere != seekEnemy)
+			{
+				const float dist = (area->GetCenter() - fromArea->GetCenter()).Length();
+				cost += dist * enemyFactor;
+			}
+		}
+		return cost;
+	}
+};
+
+/**
+ * Straight line distance to the goal. Never overestimates with any of the above costs.
+ */
+struct DistanceHeuristic
+{
+	float operator()(const CNavArea* area, const Vector& goalPos) const
+	{
+		return (area->GetCenter() - goalPos).Length();
+	}
+};
+
 // Remove possibly non-contiguous duplicates without changing list order.
 void RemoveDuplicates(NavAreaList& list)
 {
@@ -118,13 +238,24 @@ void RemoveDuplicates(NavAreaList& list)
  * This doesn't actually build a path, but the path is defined by following parent
  * pointers back from goalArea to startArea.
  * If 'closestArea' is non-NULL, the closest area to the goal is returned (useful if the path fails).
+ * The path to it can then be followed through the areas' parents, until the next search.
+ * If 'budget' is non-NULL, the search gives up once it has expanded too many areas or run for too long.
  * If 'goalArea' is NULL, will compute a path as close as possible to 'goalPos'.
  * If 'goalPos' is NULL, will use the center of 'goalArea' as the goal position.
  * Returns true if a path exists.
  * If path exists, returns the path by reference in pathList.
  */
-bool NavAreaBuildPath(CNavArea* startArea, CNavArea* goalArea, const Vector* goalPos, NavAreaList& pathList)
+template <typename CostPolicy, typename HeuristicPolicy>
+bool NavAreaBuildPath(CNavArea* startArea, CNavArea* goalArea, const Vector* goalPos,
+	const CostPolicy& costFunc, const HeuristicPolicy& heuristic, NavAreaList& pathList,
+	CNavArea** closestArea = NULL, NavSearchBudget* budget = NULL)
 {
+	if (closestArea)
+		*closestArea = NULL;
+
+	if (budget)
+		budget->exhausted = false;
+
 	if (startArea == NULL)
 		return false;
 
@@ -152,9 +283,9 @@ bool NavAreaBuildPath(CNavArea* startArea, CNavArea* goalArea, const Vector* goa
 
 	// compute estimate of path length
 	/// @todo Cost might work as "manhattan distance"
-	startArea->SetTotalCost((startArea->GetCenter() - actualGoalPos).Length());
+	startArea->SetTotalCost(heuristic(startArea, actualGoalPos));
 
-	float initCost = CostFunctor(startArea, NULL /*, NULL*/);
+	float initCost = costFunc(startArea, NULL /*, NULL*/);
 	if (initCost < 0.0f)
 		return false;
 	startArea->SetCostSoFar(initCost);
@@ -163,10 +294,33 @@ bool NavAreaBuildPath(CNavArea* startArea, CNavArea* goalArea, const Vector* goa
 
 	// keep track of the area we visit that is closest to the goal
 	float closestAreaDist = startArea->GetTotalCost();
+	if (closestArea)
+		*closestArea = startArea;
+
+	// The clock is only read every few expansions, since that costs more than an expansion itself.
+	const auto searchStart = std::chrono::steady_clock::now();
+	const size_t clockCheckInterval = 64;
+	size_t numExpansions = 0;
 
 	// do A* search
 	while (!CNavArea::IsOpenListEmpty())
 	{
+		if (budget)
+		{
+			if (budget->maxExpansions != 0 && numExpansions >= budget->maxExpansions)
+			{
+				budget->exhausted = true;
+				return false;
+			}
+			if (budget->maxMicroseconds != 0 && numExpansions % clockCheckInterval == 0 &&
+				std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - searchStart).count() >= budget->maxMicroseconds)
+			{
+				budget->exhausted = true;
+				return false;
+			}
+		}
+		++numExpansions;
+
 		// get next area to check
 		CNavArea* area = CNavArea::PopOpenList();
 		if (!area) {
@@ -307,7 +461,7 @@ bool NavAreaBuildPath(CNavArea* startArea, CNavArea* goalArea, const Vector* goa
 				if (newArea->IsBlocked())
 					continue;
 
-				float newCostSoFar = CostFunctor(newArea, area/*, ladder*/);
+				float newCostSoFar = costFunc(newArea, area/*, ladder*/);
 
 				// check if cost functor says this area is a dead-end
 				if (newCostSoFar < 0.0f)
@@ -321,12 +475,14 @@ bool NavAreaBuildPath(CNavArea* startArea, CNavArea* goalArea, const Vector* goa
 				else
 				{
 					// compute estimate of distance left to go
-					float newCostRemaining = (newArea->GetCenter() - actualGoalPos).Length();
+					float newCostRemaining = heuristic(newArea, actualGoalPos);
 
 					// track closest area to goal in case path fails
 					if (newCostRemaining < closestAreaDist)
 					{
 						closestAreaDist = newCostRemaining;
+						if (closestArea)
+							*closestArea = newArea;
 					}
 
 					newArea->SetParent(area, how);
@@ -365,4 +521,13 @@ bool NavAreaBuildPath(CNavArea* startArea, CNavArea* goalArea, const Vector* goa
 	return false;
 }
 
+/**
+ * Find the fastest route, as in the SDK.
+ */
+bool NavAreaBuildPath(CNavArea* startArea, CNavArea* goalArea, const Vector* goalPos, NavAreaList& pathList,
+	CNavArea** closestArea = NULL, NavSearchBudget* budget = NULL)
+{
+	return NavAreaBuildPath(startArea, goalArea, goalPos, FastestRouteCost(), DistanceHeuristic(), pathList, closestArea, budget);
+}
+
 #endif // _NABENABE_PATHFIND_H_
@@ -61,20 +61,18 @@ sourceengine@valvesoftware.com.
 #include "interrupt_handler.h"
 #include "print_helpers.h"
 #include "nabe_db_handler.h"
+#include "nabe_job_dispatcher.h"
 #include "nabe_pathfinder.h"
 #include "python_auto_initializer.h"
 #include "nabe_gamemap.h"
+#include "nabe_map_lock.h"
+#include "nabe_memory_job_queue.h"
+#include "nabe_shm_server.h"
+#include "nabe_socket_server.h"
 
 #ifdef _WIN32
 #include <windows.h>
 #else // Linux
-#include <fcntl.h> // For O_* constants
-#include <sys/stat.h> // For mode constants
-#include <semaphore.h>
-#include <errno.h>
-constexpr auto semaphore_name = "/nabe_singleton";
-static_assert(semaphore_name[0] == '/');
-
 #include <stdio.h>
 #endif
 
@@ -94,8 +92,13 @@ static_assert(semaphore_name[0] == '/');
 #define GetCurrentDir getcwd
 #endif
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <memory>
+#include <random>
 #include <string>
+#include <thread>
 
 #ifdef _WIN32
 //Returns the last Win32 error, in string format. Returns an empty string if there is no error.
@@ -119,36 +122,256 @@ std::string GetLastErrorAsString()
 }
 #endif
 
-#ifdef __linux__
-static sem_t* _semaphore;
-#endif
-bool EnsureAppSingleton()
+// Default worker id for claiming jobs, unique for this process.
+std::string GenerateWorkerId()
 {
 #ifdef _WIN32
-	CreateMutexA(0, FALSE, "Local\\$myprogram$");
-	const auto error = GetLastError();
-	if (error != NULL) {
-		if (error == ERROR_ALREADY_EXISTS) {
-			print(Error, "Only one instance of this program may run at the same time.");
+	const auto pid = static_cast<unsigned long>(GetCurrentProcessId());
+#else
+	const auto pid = static_cast<unsigned long>(getpid());
+#endif
+	const auto epoch = std::chrono::duration_cast<std::chrono::seconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count();
+	return "nabe_" + std::to_string(pid) + "_" + std::to_string(epoch);
+}
+
+// Read the settings of a database section of the config.
+// Any value not set in the section is inherited from the [database] section, so that servers sharing most
+// of their settings only need to list the differences.
+bool ReadDatabaseSettings(INI::File& ft, const std::string& section_name, NABE_DatabaseSettings& out_settings)
+{
+	const auto section = ft.FindSection(section_name);
+	if (!section) {
+		print(Error, "%s: No such database section in config: [%s]", __FUNCTION__, section_name.c_str());
+		return false;
+	}
+	const auto base = ft.GetSection("database");
+	auto value = [&](const char* key, const INI::Value& def = INI::Value()) {
+		return section->GetValue(key, base->GetValue(key, def));
+	};
+
+	const auto db_type = value("type").AsString();
+	if (db_type.compare("sqlite3") != 0) {
+		print(Error, "%s: [%s]: Unsupported database type: \"%s\"", __FUNCTION__, section_name.c_str(), db_type.c_str());
+		return false;
+	}
+
+	out_settings.location = value("location").AsString();
+	const auto max_retries = value("locked_max_retries").AsInt();
+	const auto max_solves_at_once = value("max_solves_at_one_time", 50).AsInt();
+	out_settings.adaptive_batch_size = value("adaptive_batch_size").AsBool();
+	const auto min_solves_at_once = value("min_solves_at_one_time", 1).AsInt();
+	out_settings.target_commit_ms = value("target_commit_ms", 20).AsDouble();
+	out_settings.persist_area_solutions = value("persist_area_solutions").AsBool();
+	out_settings.compact_solutions = value("compact_solutions").AsBool();
+	out_settings.worker_id = value("worker_id").AsString();
+	const auto claim_lease_seconds = value("claim_lease_seconds", 60).AsInt();
+	out_settings.exclusive_maps = value("exclusive_maps", 1).AsBool();
+	const auto blocked_poll_interval_ms = value("blocked_poll_interval_ms").AsInt();
+	const auto danger_poll_interval_ms = value("danger_poll_interval_ms").AsInt();
+
+	auto& tuning = out_settings.tuning;
+	tuning.journal_mode_wal = value("journal_mode_wal").AsBool();
+	tuning.synchronous_normal = value("synchronous_normal").AsBool();
+	tuning.mmap_size = static_cast<long long>(value("mmap_size_mb").AsInt()) * 1024 * 1024;
+	tuning.cache_size_kb = value("cache_size_kb").AsInt();
+	tuning.incremental_vacuum = value("incremental_vacuum").AsBool();
+	tuning.incremental_vacuum_pages = value("incremental_vacuum_pages", 64).AsInt();
+	tuning.busy_timeout_ms = value("locked_timeout_ms", 1000).AsInt();
+
+	if (out_settings.location.empty()) {
+		print(Error, "%s: [%s]: Missing database location", __FUNCTION__, section_name.c_str());
+		return false;
+	}
+
+	if (max_retries < 0) {
+		print(Error, "%s: [%s]: Invalid locked_max_retries: %d", __FUNCTION__, section_name.c_str(), max_retries);
+		return false;
+	}
+	out_settings.max_retries = static_cast<size_t>(max_retries);
+
+	if (max_solves_at_once <= 0 || min_solves_at_once <= 0 || out_settings.target_commit_ms <= 0) {
+		print(Error, "%s: [%s]: Invalid batch size value in config (max_solves_at_one_time, min_solves_at_one_time, target_commit_ms)",
+			__FUNCTION__, section_name.c_str());
+		return false;
+	}
+	out_settings.max_solves_at_once = static_cast<size_t>(max_solves_at_once);
+	out_settings.min_solves_at_once = static_cast<size_t>(min_solves_at_once);
+
+	if (out_settings.worker_id.empty()) {
+		out_settings.worker_id = GenerateWorkerId();
+	}
+	if (claim_lease_seconds <= 0) {
+		print(Error, "%s: [%s]: Invalid claim_lease_seconds: %d", __FUNCTION__, section_name.c_str(), claim_lease_seconds);
+		return false;
+	}
+	out_settings.claim_lease_seconds = static_cast<size_t>(claim_lease_seconds);
+
+	if (blocked_poll_interval_ms < 0) {
+		print(Error, "%s: [%s]: Invalid blocked_poll_interval_ms: %d", __FUNCTION__, section_name.c_str(), blocked_poll_interval_ms);
+		return false;
+	}
+	out_settings.blocked_poll_interval_ms = static_cast<size_t>(blocked_poll_interval_ms);
+
+	if (danger_poll_interval_ms < 0) {
+		print(Error, "%s: [%s]: Invalid danger_poll_interval_ms: %d", __FUNCTION__, section_name.c_str(), danger_poll_interval_ms);
+		return false;
+	}
+	out_settings.danger_poll_interval_ms = static_cast<size_t>(danger_poll_interval_ms);
+
+	if (tuning.mmap_size < 0 || tuning.cache_size_kb < 0 || tuning.incremental_vacuum_pages <= 0 || tuning.busy_timeout_ms < 0) {
+		print(Error, "%s: [%s]: Invalid database tuning value in config (mmap_size_mb, cache_size_kb, incremental_vacuum_pages, locked_timeout_ms)",
+			__FUNCTION__, section_name.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+// Solve the paths between each map's hot spots ahead of time, so that the first requests of a round are served
+// from the path cache. Hot spots are listed per map in the [precompute] section of the config,
+// and/or picked from the positions of the most recently solved jobs.
+// Pairs of hot positions are also queued as low priority jobs, so that their solutions get written to the database.
+void PrecomputeHotPaths(INI::File& ft, NABE_PathFinder& pathfinder, const std::vector<NABE_GameMap*>& maps,
+	const std::vector<std::unique_ptr<NABE_DatabaseHandler>>& db_handlers)
+{
+	const auto section = ft.GetSection("precompute");
+	auto num_threads = section->GetValue("threads").AsInt();
+	const auto history_solutions = section->GetValue("history_solutions").AsInt();
+	const auto max_areas_per_map = section->GetValue("max_areas_per_map", 64).AsInt();
+	const auto job_priority = section->GetValue("job_priority", -1).AsInt();
+
+	if (num_threads <= 0) {
+		num_threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+	}
+	if (history_solutions < 0 || max_areas_per_map <= 0) {
+		print(Error, "%s: Invalid precompute value in config (history_solutions, max_areas_per_map)", __FUNCTION__);
+		return;
+	}
+
+	for (auto& map : maps) {
+		if (!pathfinder.HasMap(map->map_name)) {
+			continue;
 		}
-		else {
-			print(Error, "Unexpected error occurred whilst creating an app mutex: \"%s\"",
-				GetLastErrorAsString().c_str());
+
+		std::vector<int> area_ids;
+		std::vector<Vector> positions;
+
+		const auto hot_spots = section->GetValue(map->map_name).AsArray();
+		for (int i = 0; i < hot_spots.Size(); ++i) {
+			const auto hot_spot = hot_spots.GetValue(i).AsString();
+			Vector pos;
+			if (sscanf(hot_spot.c_str(), "%f:%f:%f", &pos.x, &pos.y, &pos.z) == 3) {
+				positions.push_back(pos);
+			}
+			else if (atoi(hot_spot.c_str()) > 0) {
+				area_ids.push_back(atoi(hot_spot.c_str()));
+			}
+			else {
+				print(Warning, "%s: Invalid hot spot for \"%s\": \"%s\" (expected an area id, or x:y:z)",
+					__FUNCTION__, map->map_name.c_str(), hot_spot.c_str());
+			}
+		}
+
+		if (history_solutions > 0) {
+			std::vector<Vector> recent_positions;
+			for (auto& db_handler : db_handlers) {
+				if (db_handler->HasMap(map->map_name) &&
+					db_handler->GetRecentPositions(map->map_name, static_cast<size_t>(history_solutions), recent_positions))
+				{
+					positions.insert(positions.end(), recent_positions.begin(), recent_positions.end());
+				}
+			}
+		}
+
+		std::vector<Vector> hot_positions;
+		for (auto& pos : positions) {
+			int area_id, unused;
+			if (static_cast<int>(area_ids.size()) >= max_areas_per_map) {
+				break;
+			}
+			if (std::find(hot_positions.begin(), hot_positions.end(), pos) != hot_positions.end() ||
+				!pathfinder.ResolveAreas(map->map_name, pos, pos, area_id, unused))
+			{
+				continue;
+			}
+			hot_positions.push_back(pos);
+			area_ids.push_back(area_id);
+		}
+		if (static_cast<int>(area_ids.size()) > max_areas_per_map) {
+			area_ids.resize(max_areas_per_map);
+		}
+		if (area_ids.empty()) {
+			continue;
+		}
+
+		print(Info, "Precomputing paths between %zd hot areas of \"%s\"...", area_ids.size(), map->map_name.c_str());
+		const auto num_found = pathfinder.Precompute(map->map_name, area_ids, static_cast<size_t>(num_threads));
+		print(Info, "Precomputed %zd paths for \"%s\".", num_found, map->map_name.c_str());
+
+		std::vector<std::pair<Vector, Vector>> position_pairs;
+		for (auto& from : hot_positions) {
+			for (auto& to : hot_positions) {
+				if (!(from == to)) {
+					position_pairs.emplace_back(from, to);
+				}
+			}
+		}
+		if (!position_pairs.empty()) {
+			for (auto& db_handler : db_handlers) {
+				if (db_handler->HasMap(map->map_name)) {
+					db_handler->AddJobs(map->map_name, position_pairs, job_priority);
+				}
+			}
 		}
 	}
-	return error == NULL;
-#else
-	_semaphore = sem_open(semaphore_name, O_CREAT | O_EXCL, 0, 0);
-	if (_semaphore == SEM_FAILED) {
-		if (errno == EEXIST) {
-			print(Error, "Only one instance of this program may run at the same time.");
+}
+
+// Solve random jobs between the nav areas of each map through an in-memory job queue, the same way as the jobs
+// of a database, and report how fast they were solved.
+void BenchmarkSolver(INI::File& ft, NABE_PathFinder& pathfinder, const std::vector<NABE_GameMap*>& maps, bool verbosity)
+{
+	const auto section = ft.GetSection("benchmark");
+	const auto jobs_per_map = section->GetValue("jobs_per_map", 1000).AsInt();
+	const auto batch_size = section->GetValue("batch_size", 64).AsInt();
+	if (jobs_per_map <= 0 || batch_size <= 0) {
+		print(Error, "%s: Invalid benchmark value in config (jobs_per_map, batch_size)", __FUNCTION__);
+		return;
+	}
+
+	// Same jobs every run, so that runs can be compared.
+	std::mt19937 rng(1);
+	NABE_JobDispatcher dispatcher(&pathfinder, verbosity);
+	for (auto& map : maps) {
+		std::vector<Vector> centers;
+		if (!pathfinder.HasMap(map->map_name) || !pathfinder.GetAreaCenters(map->map_name, centers)) {
+			continue;
 		}
-		else {
-			print(Error, "Semaphore open failed (errno %d)", errno);
+
+		NABE_MemoryJobQueue queue(static_cast<size_t>(batch_size));
+		std::vector<long long> ids;
+		std::uniform_int_distribution<size_t> pick(0, centers.size() - 1);
+		for (int i = 0; i < jobs_per_map; ++i) {
+			ids.push_back(queue.AddJob(map->map_name, centers[pick(rng)], centers[pick(rng)]));
 		}
+
+		const auto start = std::chrono::steady_clock::now();
+		while (queue.GetNumPending() != 0) {
+			dispatcher.Dispatch(queue, queue);
+		}
+		const auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		size_t num_solved = 0;
+		NABE_JobStatus status;
+		std::vector<Vector> waypoints;
+		for (auto id : ids) {
+			if (queue.TakeResult(id, status, waypoints) && status == NABE_JobStatus::Solved) {
+				++num_solved;
+			}
+		}
+		print(Info, "Benchmark of \"%s\": %d jobs in %.1f ms (%.0f jobs/s), %zd solved.", map->map_name.c_str(),
+			jobs_per_map, ms, (ms > 0) ? jobs_per_map * 1000.0 / ms : 0.0, num_solved);
 	}
-	return _semaphore != SEM_FAILED;
-#endif
 }
 
 // Entry point
@@ -187,10 +410,6 @@ int main(int argc, char** argv)
 
 	print(Info, "Initializing...");
 
-	if (!EnsureAppSingleton()) {
-		return 1;
-	}
-
 	{
 		char config_file_path[PATH_MAX]{ 0 };
 
@@ -203,14 +422,14 @@ int main(int argc, char** argv)
 			{
 				print(Error, "%s: Failed to get config file path.", __FUNCTION__);
 				return_value = 1;
-				goto semaphore_cleanup;
+				goto cleanup;
 			}
 		}
 		else {
 			if (!GetCurrentDir(config_file_path, sizeof(config_file_path))) {
 				print(Error, "%s Failed to get current working dir.", __FUNCTION__);
 				return_value = 1;
-				goto semaphore_cleanup;
+				goto cleanup;
 			}
 			constexpr auto config_file = "config.ini";
 
@@ -222,7 +441,7 @@ int main(int argc, char** argv)
 			{
 				print(Error, "%s: Failed to concatenate to config path (1).", __FUNCTION__);
 				return_value = 1;
-				goto semaphore_cleanup;
+				goto cleanup;
 			}
 
 #ifdef _WIN32
@@ -233,7 +452,7 @@ int main(int argc, char** argv)
 			{
 				print(Error, "%s: Failed to concatenate to config path (2).", __FUNCTION__);
 				return_value = 1;
-				goto semaphore_cleanup;
+				goto cleanup;
 			}
 		}
 
@@ -241,23 +460,58 @@ int main(int argc, char** argv)
 		if (!ft.Load(config_file_path)) {
 			print(Error, "%s: Failed to read config file from: \"%s\"", __FUNCTION__, config_file_path);
 			return_value = 1;
-			goto semaphore_cleanup;
+			goto cleanup;
 		}
 
-		const auto db_type = ft.GetSection("database")->GetValue("type").AsString();
-		if (db_type.compare("sqlite3") != 0) {
-			print(Error, "%s: Unsupported database type: \"%s\"", __FUNCTION__, db_type.c_str());
-			return_value = 1;
-			goto semaphore_cleanup;
-		}
-
-		const auto db_location = ft.GetSection("database")->GetValue("location").AsString();
-		const auto max_retries = ft.GetSection("database")->GetValue("locked_max_retries").AsInt();
-		const auto max_solves_at_once = ft.GetSection("database")->GetValue("max_solves_at_one_time").AsInt();
 		const auto maps_folder_path = ft.GetSection("gameserver")->GetValue("maps_folder_path").AsString();
 		const auto navs_folder_path = ft.GetSection("solver")->GetValue("navs_folder_path").AsString();
 		const auto supported_maps = ft.GetSection("solver")->GetValue("supported_maps_list").AsArray();
 		const auto solver_verbosity = ft.GetSection("solver")->GetValue("verbose_debug").AsBool();
+		const auto path_cache_size = ft.GetSection("solver")->GetValue("path_cache_size").AsInt();
+		const auto goal_tree_cache_size = ft.GetSection("solver")->GetValue("goal_tree_cache_size").AsInt();
+		const auto goal_tree_min_requests = ft.GetSection("solver")->GetValue("goal_tree_min_requests", 8).AsInt();
+		const auto max_search_expansions = ft.GetSection("solver")->GetValue("max_search_expansions").AsInt();
+		const auto max_search_microseconds = ft.GetSection("solver")->GetValue("max_search_microseconds").AsInt();
+		const auto partial_paths = ft.GetSection("solver")->GetValue("partial_paths").AsBool();
+		const auto first_move_table_max_areas = ft.GetSection("solver")->GetValue("first_move_table_max_areas").AsInt();
+		auto first_move_table_threads = ft.GetSection("solver")->GetValue("first_move_table_threads").AsInt();
+		const auto first_move_table_cache = ft.GetSection("solver")->GetValue("first_move_table_cache", true).AsBool();
+		const auto route_landmark_masks = ft.GetSection("solver")->GetValue("route_landmark_masks").AsArray();
+		const auto route_landmarks = ft.GetSection("solver")->GetValue("route_landmarks", 8).AsInt();
+		const auto danger_half_life_seconds = ft.GetSection("solver")->GetValue("danger_half_life_seconds", 30).AsDouble();
+		const auto danger_decay_interval_ms = ft.GetSection("solver")->GetValue("danger_decay_interval_ms", 1000).AsInt();
+		const auto smooth_paths = ft.GetSection("solver")->GetValue("smooth_paths", true).AsBool();
+		const auto waypoint_tolerance = ft.GetSection("solver")->GetValue("waypoint_tolerance").AsDouble();
+		const auto edge_cost_model = ft.GetSection("solver")->GetValue("edge_cost_model", "centers").AsString();
+		const auto socket_server_enabled = ft.GetSection("socket")->GetValue("enabled").AsBool();
+		const auto socket_path = ft.GetSection("socket")->GetValue("path", "/tmp/nabe.sock").AsString();
+		const auto shm_enabled = ft.GetSection("shm")->GetValue("enabled").AsBool();
+		const auto shm_name = ft.GetSection("shm")->GetValue("name", "/nabe").AsString();
+		const auto shm_ring_capacity_kb = ft.GetSection("shm")->GetValue("ring_capacity_kb", 1024).AsInt();
+		const auto precompute_enabled = ft.GetSection("precompute")->GetValue("enabled").AsBool();
+		const auto benchmark_enabled = ft.GetSection("benchmark")->GetValue("enabled", 0).AsBool();
+		const auto database_sections = ft.GetSection("solver")->GetValue("database_sections", "database").AsArray();
+
+		std::vector<NABE_DatabaseSettings> db_settings(database_sections.Size());
+		for (int i = 0; i < database_sections.Size(); ++i) {
+			if (!ReadDatabaseSettings(ft, database_sections.GetValue(i).AsString(), db_settings[i])) {
+				return_value = 1;
+				goto cleanup;
+			}
+			for (int j = 0; j < i; ++j) {
+				if (db_settings[j].location.compare(db_settings[i].location) == 0) {
+					print(Error, "%s: Database \"%s\" is listed more than once in solver::database_sections",
+						__FUNCTION__, db_settings[i].location.c_str());
+					return_value = 1;
+					goto cleanup;
+				}
+			}
+		}
+		if (db_settings.empty()) {
+			print(Error, "%s: No databases listed in config file's solver::database_sections", __FUNCTION__);
+			return_value = 1;
+			goto cleanup;
+		}
 
 		std::vector<NABE_GameMap*> maps;
 		for (int i = 0; i < supported_maps.Size(); ++i) {
@@ -268,33 +522,176 @@ int main(int argc, char** argv)
 				}
 				print(Error, "%s: Received empty map name in config file's solver::supported_maps_list", __FUNCTION__);
 				return_value = 1;
-				goto semaphore_cleanup;
+				goto cleanup;
 			}
 			maps.push_back(new NABE_GameMap(maps_folder_path, map_name));
 		}
 
+		if (path_cache_size < 0) {
+			print(Error, "%s: Invalid solver::path_cache_size: %d", __FUNCTION__, path_cache_size);
+			return_value = 1;
+			goto cleanup;
+		}
+
+		if (goal_tree_cache_size < 0 || goal_tree_min_requests <= 0) {
+			print(Error, "%s: Invalid goal tree value in config (goal_tree_cache_size, goal_tree_min_requests)", __FUNCTION__);
+			return_value = 1;
+			goto cleanup;
+		}
+
+		if (max_search_expansions < 0 || max_search_microseconds < 0) {
+			print(Error, "%s: Invalid search budget in config (max_search_expansions, max_search_microseconds)", __FUNCTION__);
+			return_value = 1;
+			goto cleanup;
+		}
+
+		if (first_move_table_max_areas < 0 || first_move_table_threads < 0) {
+			print(Error, "%s: Invalid first-move table value in config (first_move_table_max_areas, first_move_table_threads)", __FUNCTION__);
+			return_value = 1;
+			goto cleanup;
+		}
+		if (first_move_table_threads == 0) {
+			first_move_table_threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+		}
+
+		if (route_landmarks < 0) {
+			print(Error, "%s: Invalid solver::route_landmarks: %d", __FUNCTION__, route_landmarks);
+			return_value = 1;
+			goto cleanup;
+		}
+		if (danger_half_life_seconds < 0 || danger_decay_interval_ms < 0) {
+			print(Error, "%s: Invalid danger value in config (danger_half_life_seconds, danger_decay_interval_ms)", __FUNCTION__);
+			return_value = 1;
+			goto cleanup;
+		}
+
+		if (waypoint_tolerance < 0) {
+			print(Error, "%s: Invalid solver::waypoint_tolerance: %f", __FUNCTION__, waypoint_tolerance);
+			return_value = 1;
+			goto cleanup;
+		}
+
+		NABE_EdgeCostModel cost_model;
+		if (edge_cost_model.compare("centers") == 0) {
+			cost_model = NABE_EdgeCostModel::Centers;
+		}
+		else if (edge_cost_model.compare("portals") == 0) {
+			cost_model = NABE_EdgeCostModel::Portals;
+		}
+		else {
+			print(Error, "%s: Unsupported solver::edge_cost_model: \"%s\"", __FUNCTION__, edge_cost_model.c_str());
+			return_value = 1;
+			goto cleanup;
+		}
+
+		std::vector<NABE_RouteOptions> landmark_routes;
+		for (int i = 0; i < route_landmark_masks.Size(); ++i) {
+			const auto masks = route_landmark_masks.GetValue(i).AsString();
+			if (masks.empty()) {
+				continue;
+			}
+			NABE_RouteOptions route;
+			if (sscanf(masks.c_str(), "%i:%i", &route.avoid_attributes, &route.allow_attributes) != 2 || route.IsDefault()) {
+				print(Error, "%s: Invalid mask pair in solver::route_landmark_masks: \"%s\" (expected avoid:allow)",
+					__FUNCTION__, masks.c_str());
+				return_value = 1;
+				goto cleanup;
+			}
+			landmark_routes.push_back(route);
+		}
+
 		NABE_PathFinder pathfinder(maps_folder_path, navs_folder_path, solver_verbosity);
+		pathfinder.SetPathCacheSize(static_cast<size_t>(path_cache_size));
+		pathfinder.SetGoalTreeCacheSize(static_cast<size_t>(goal_tree_cache_size), static_cast<size_t>(goal_tree_min_requests));
+		pathfinder.SetSearchBudget(static_cast<size_t>(max_search_expansions), max_search_microseconds, partial_paths);
+		pathfinder.SetFirstMoveTables(static_cast<size_t>(first_move_table_max_areas),
+			static_cast<size_t>(first_move_table_threads), first_move_table_cache);
+		pathfinder.SetLandmarks(landmark_routes, static_cast<size_t>(route_landmarks));
+		pathfinder.SetDangerDecay(static_cast<float>(danger_half_life_seconds), static_cast<size_t>(danger_decay_interval_ms));
+		pathfinder.SetEdgeCostModel(cost_model);
+		pathfinder.SetSmoothPaths(smooth_paths);
+		pathfinder.SetWaypointTolerance(static_cast<float>(waypoint_tolerance));
+
+		// Every database is served by the same pathfinder, so each map's nav data is only loaded once,
+		// no matter how many game servers are solving for it.
+		std::vector<std::unique_ptr<NABE_DatabaseHandler>> db_handlers;
+		for (auto& settings : db_settings) {
+			print(Info, "Claiming jobs of \"%s\" as worker \"%s\".", settings.location.c_str(), settings.worker_id.c_str());
+			db_handlers.push_back(std::make_unique<NABE_DatabaseHandler>(&pathfinder, settings, solver_verbosity));
+			if (!db_handlers.back()->Open()) {
+				return_value = 1;
+				goto cleanup;
+			}
+		}
 
-		NABE_DatabaseHandler db_handler(&pathfinder, db_location.c_str(), maps_folder_path.c_str(), max_retries, solver_verbosity, max_solves_at_once);
+		// Held for as long as we're solving, so other nabe processes on this database will leave these maps to us.
+		std::vector<std::unique_ptr<NABE_MapLock>> map_locks;
 
 		PythonAutoInitializer pai;
 		if (!pai.IsPythonReady()) {
 			return_value = 1;
-			goto semaphore_cleanup;
+			goto cleanup;
 		}
 
 		enable_interrupt_handler();
 
 		print(Info, "Loading navigation data into memory. This may take a few moments...");
 		size_t num_processed = 0;
+		size_t num_skipped = 0;
 		const size_t total_num_to_process = maps.size();
 		for (auto& map : maps) {
+			// Databases that want this map solved.
+			std::vector<NABE_DatabaseHandler*> map_db_handlers;
+			bool lock_failed = false;
+			for (auto& db_handler : db_handlers) {
+				const auto& settings = db_handler->GetSettings();
+				if (settings.exclusive_maps) {
+					auto lock = std::make_unique<NABE_MapLock>(settings.location, map->map_name);
+					const auto lock_result = lock->TryLock();
+					if (lock_result == NABE_MapLock::Result::Failed) {
+						lock_failed = true;
+						break;
+					}
+					else if (lock_result == NABE_MapLock::Result::HeldByOther) {
+						if (db_handlers.size() > 1) {
+							print(Info, "** \"%s\" of \"%s\" is already being solved by another nabe process.",
+								map->map_name.c_str(), settings.location.c_str());
+						}
+						continue;
+					}
+					map_locks.push_back(std::move(lock));
+				}
+				map_db_handlers.push_back(db_handler.get());
+			}
+			if (lock_failed) {
+				break;
+			}
+			else if (map_db_handlers.empty()) {
+				print(Info, "** Skipping \"%s\": already being solved by another nabe process. (%d/%d)",
+					map->map_name.c_str(), ++num_processed, total_num_to_process);
+				++num_skipped;
+				continue;
+			}
+			else if (map_db_handlers.size() > 1) {
+				// The blocked state lives on the map's areas, so it would apply to the jobs of every database.
+				const auto polls_blocked = std::find_if(map_db_handlers.begin(), map_db_handlers.end(),
+					[](NABE_DatabaseHandler* db_handler) { return db_handler->GetSettings().blocked_poll_interval_ms != 0; });
+				if (polls_blocked != map_db_handlers.end()) {
+					print(Error, "%s: \"%s\" is served by %zd databases, but \"%s\" reads blocked areas, which would apply to all of them."
+						" Set blocked_poll_interval_ms to 0, or serve the map from a single database.", __FUNCTION__, map->map_name.c_str(),
+						map_db_handlers.size(), (*polls_blocked)->GetSettings().location.c_str());
+					break;
+				}
+			}
+
 			print(RawText, "** Processing navigation data for: \"%s\"...", map->map_name.c_str());
 			if (solver_verbosity) {
 				print(NewLine);
 			}
 
-			if (!db_handler.AddMap(map)) {
+			if (!std::all_of(map_db_handlers.begin(), map_db_handlers.end(),
+				[&](NABE_DatabaseHandler* db_handler) { return db_handler->AddMap(map); }))
+			{
 				break;
 			}
 			else if (!pathfinder.AddMap(map)) {
@@ -306,33 +703,69 @@ int main(int argc, char** argv)
 		if (num_processed != total_num_to_process) {
 			print(Error, "%s: Failed to initialize nav data.", __FUNCTION__);
 			return_value = 1;
-			goto semaphore_cleanup;
+			goto cleanup;
+		}
+		else if (num_skipped == total_num_to_process) {
+			print(Error, "%s: All maps are already being solved by other nabe processes.", __FUNCTION__);
+			return_value = 1;
+			goto cleanup;
 		}
 		else {
+			if (precompute_enabled) {
+				PrecomputeHotPaths(ft, pathfinder, maps, db_handlers);
+			}
+			if (benchmark_enabled) {
+				BenchmarkSolver(ft, pathfinder, maps, solver_verbosity);
+			}
+
+			std::unique_ptr<NABE_SocketServer> socket_server;
+			if (socket_server_enabled) {
+				socket_server = std::make_unique<NABE_SocketServer>(socket_path, solver_verbosity);
+				if (!socket_server->Start()) {
+					return_value = 1;
+					goto cleanup;
+				}
+			}
+
+			std::unique_ptr<NABE_ShmServer> shm_server;
+			if (shm_enabled) {
+				if (shm_ring_capacity_kb <= 0) {
+					print(Error, "%s: Invalid shm::ring_capacity_kb: %d", __FUNCTION__, shm_ring_capacity_kb);
+					return_value = 1;
+					goto cleanup;
+				}
+				shm_server = std::make_unique<NABE_ShmServer>(shm_name,
+					static_cast<uint32_t>(shm_ring_capacity_kb) * 1024, solver_verbosity);
+				if (!shm_server->Start()) {
+					return_value = 1;
+					goto cleanup;
+				}
+			}
+
+			std::vector<NABE_JobTransport> transports;
+			for (auto& db_handler : db_handlers) {
+				transports.push_back({ db_handler.get(), db_handler.get() });
+			}
+			if (socket_server) {
+				transports.push_back({ socket_server.get(), socket_server.get() });
+			}
+			if (shm_server) {
+				transports.push_back({ shm_server.get(), shm_server.get() });
+			}
+			NABE_JobDispatcher dispatcher(&pathfinder, solver_verbosity);
+
 			print(Info, "Initialization complete. Now actively listening for navigation jobs.");
 			print(Info, "Use system interrupt (Ctrl+C) to shut down.");
 			while (!was_interrupted()) {
-				db_handler.GetJobs();
-				db_handler.HandlePendingQueries();
-				db_handler.Sleep();
+				if (dispatcher.DispatchAll(transports) == 0) {
+					dispatcher.Idle(transports, NABE_IDLE_SLEEP_MS);
+				}
 			}
 		}
 	}
 
-	semaphore_cleanup: // TODO: refactor this jump out
+	cleanup: // TODO: refactor this jump out
 	print(Info, "Shutting down.");
-#ifdef __linux__
-	if (_semaphore != SEM_FAILED) {
-		if (sem_close(_semaphore) != 0) {
-			print(Error, "%s: Failed to close semaphore (errno %d)", __FUNCTION__, errno);
-		}
-	}
-	if (sem_unlink(semaphore_name) != 0) {
-		if (_semaphore != SEM_FAILED) {
-			print(Error, "%s: Failed to unlink semaphore (errno %d)", __FUNCTION__, errno);
-		}
-	}
-#endif
 
 	return return_value;
 }
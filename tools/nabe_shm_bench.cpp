@@ -0,0 +1,68 @@
+// Latency benchmark for nabe's shared memory transport.
+// Sends requests one at a time to a running nabe, and reports the round trip latency percentiles.
+//
+// Usage: nabe_shm_bench shm_name map_name from_x from_y from_z to_x to_y to_z (num_requests)
+
+#include "nabe_shm_client.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+	if (argc != 9 && argc != 10) {
+		printf("Usage: %s shm_name map_name from_x from_y from_z to_x to_y to_z (num_requests)\n", argv[0]);
+		return 1;
+	}
+
+	NABE_ShmClient client;
+	if (!client.Open(argv[1])) {
+		printf("Failed to open shared memory \"%s\". Is nabe running with shm enabled?\n", argv[1]);
+		return 1;
+	}
+
+	const std::string map_name = argv[2];
+	NABE_IpcRequestHeader request{};
+	request.flags = NABE_IPC_FLAG_NONE;
+	for (int i = 0; i < 3; ++i) {
+		request.pos_from[i] = static_cast<float>(atof(argv[3 + i]));
+		request.pos_to[i] = static_cast<float>(atof(argv[6 + i]));
+	}
+	const size_t num_requests = (argc == 10) ? strtoull(argv[9], nullptr, 10) : 100000;
+	if (num_requests == 0) {
+		printf("Invalid number of requests\n");
+		return 1;
+	}
+
+	NABE_IpcResponseHeader response;
+	std::vector<float> waypoints;
+
+	// Warm up, so the first solve isn't measured.
+	if (!client.Request(request, map_name, response, waypoints)) {
+		printf("No response from nabe\n");
+		return 1;
+	}
+	printf("Status %u, %u waypoints\n", response.status, response.num_waypoints);
+
+	std::vector<double> latencies_us;
+	latencies_us.reserve(num_requests);
+	for (size_t i = 0; i < num_requests; ++i) {
+		request.request_id = static_cast<uint32_t>(i);
+		const auto start = std::chrono::steady_clock::now();
+		if (!client.Request(request, map_name, response, waypoints) || response.request_id != request.request_id) {
+			printf("Request %zu failed\n", i);
+			return 1;
+		}
+		latencies_us.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+	}
+
+	std::sort(latencies_us.begin(), latencies_us.end());
+	auto percentile = [&](double p) { return latencies_us[std::min(latencies_us.size() - 1, static_cast<size_t>(p * latencies_us.size()))]; };
+	printf("%zu requests, round trip latency in microseconds:\n", num_requests);
+	printf("  p50 %.2f  p90 %.2f  p99 %.2f  p99.9 %.2f  max %.2f\n",
+		percentile(0.5), percentile(0.9), percentile(0.99), percentile(0.999), latencies_us.back());
+	return 0;
+}